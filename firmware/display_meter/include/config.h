@@ -1,17 +1,134 @@
 #ifndef DISPLAY_CONFIG_H
 #define DISPLAY_CONFIG_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 static constexpr const char* kBleDeviceName = "TECHIN514_DISPLAY";
 static constexpr const char* kBleServiceUuid = "6f7f0001-8f3b-4c3a-a39a-3f8ec4dca101";
 static constexpr const char* kBleCharUuid = "6f7f0002-8f3b-4c3a-a39a-3f8ec4dca101";
 
+// kGatt: connect + notify. kAdvertising: broadcast the payload in adverts
+// (no connection). Tag and display must agree.
+enum class BleTransport : uint8_t {
+  kGatt,
+  kAdvertising,
+};
+static constexpr BleTransport kBleTransport = BleTransport::kAdvertising;
+
+// 0xFFFF is the Bluetooth SIG company ID reserved for internal/test use.
+static constexpr uint16_t kBleAdvCompanyId = 0xFFFF;
+
+// Passive scan interval == window, i.e. the receiver listens continuously.
+static constexpr uint16_t kBleAdvScanIntervalMs = 100;
+
 static constexpr uint32_t kBleScanSeconds = 4;
+
+// Multi-pet households: the display tracks up to kMaxTags sensor tags by BLE
+// address. Adverts from every tag arrive through the one passive scan; over
+// GATT, one active scan finds every tag in range and each gets its own link
+// (up to hal::ble::kMaxLinks). While links are missing the display rescans
+// every kTagRescanMs, so scan cost does not grow with the number of tags.
+static constexpr size_t kMaxTags = 4;
+static constexpr uint32_t kTagRescanMs = 60000;
+// The gauge aggregates tags whose newest window is at most kTagStaleMs old:
+// the mean of their activity, or the most active pet (kGaugeShowsMax). A
+// still pet's tag in the normal tier can stay quiet for ~1 h (backed-off
+// sleep x batching); a tag in a power-saving tier gets
+// protocol::tierQuietScale() times as long (up to ~34 h when critical).
+static constexpr uint32_t kTagStaleMs = 90UL * 60UL * 1000UL;
+static constexpr bool kGaugeShowsMax = false;
+
+// Daily totals per tag (daily_stats.h) for the last kHistoryDays days, on
+// the display's clock (days roll over at its midnight). Each window counts
+// for the time since the tag's previous one: kTagWindowSpanS for the first
+// (the tag's base sleep), at most kTagMaxWindowSpanS (its longest sleep plus
+// the window) times the sleep factor of the tag's tier (protocol::tierScale())
+// each.
+static constexpr size_t kHistoryDays = 7;
+static constexpr uint32_t kTagWindowSpanS = 30;
+static constexpr uint32_t kTagMaxWindowSpanS = 965;
+
+// Proximity (proximity.h) from the RSSI of every advert or notification. A
+// tag is near at or above kNearEnterDbm and away again below kNearExitDbm;
+// the band keeps a pet at the edge from flickering. -70 dBm is roughly two
+// metres from the display at the tag's default TX power; calibrate per room.
+// The filter's steady gain is 1/2^kRssiFilterShift and no packet moves it
+// by more than kRssiMaxStepDb. Time between packets more than kNearMaxGapS
+// apart never counts as near. A tag only transmits once per batch, so that
+// is the normal tier's longest silence (the kTagStaleMs margin), times
+// protocol::tierQuietScale() for a tag in a power-saving tier: a near but
+// idle tag must not be taken for gone.
+static constexpr int8_t kNearEnterDbm = -70;
+static constexpr int8_t kNearExitDbm = -78;
+static constexpr uint8_t kRssiFilterShift = 2;
+static constexpr int16_t kRssiMaxStepDb = 16;
+static constexpr uint32_t kNearMaxGapS = kTagStaleMs / 1000UL;
+
+// What the needle shows: the newest activity score, today's active (walking
+// + high) minutes as a share of kActiveGoalMinutes, or today's minutes near
+// the display as a share of kNearGoalMinutes. The LED shows whether any tag
+// is near.
+enum class GaugeSource : uint8_t {
+  kLatestActivity,
+  kActiveToday,
+  kNearToday,
+};
+static constexpr GaugeSource kGaugeSource = GaugeSource::kActiveToday;
+static constexpr uint32_t kActiveGoalMinutes = 120;
+static constexpr uint32_t kNearGoalMinutes = 240;
+// Serial command byte that prints today's per-hour histograms.
+static constexpr int kDailyDumpCommand = 'D';
+
+// The main loop blocks on events from the BLE callbacks, the button and the
+// motor (hal/events.h), with automatic light sleep in between where the SDK
+// supports it. After kDataWaitTimeoutMs without one it passes through IDLE,
+// which also serves Serial commands. Button presses closer together than
+// kButtonDebounceMs count once.
 static constexpr uint32_t kDataWaitTimeoutMs = 8000;
-static constexpr uint32_t kIdleDelayMs = 300;
+static constexpr uint32_t kButtonDebounceMs = 200;
 
 static constexpr int kGaugeMaxSteps = 600;
-static constexpr uint32_t kMotorStepDelayUs = 1200;
+// Stepper ramp: the needle starts from rest at one half-step per
+// kMotorStartStepUs and accelerates (constant acceleration, ~57k steps/s^2)
+// until it cruises at kMotorCruiseStepUs; a full sweep takes ~0.4 s.
+static constexpr uint32_t kMotorStartStepUs = 4000;
+static constexpr uint32_t kMotorCruiseStepUs = 600;
+static constexpr int kMotorMaxRampSteps = 64;
+
+// Coil drive. kHalfStep switches all four coil pins together on one GPIO
+// register write per half-step. kMicrostep drives each pin from its own LEDC
+// PWM channel (kMotorPwmFirstChannel onwards) with sine/cosine coil currents,
+// kMotorMicrosteps positions per half-step; without the torque steps of the
+// half-step table the needle can cruise at kMotorMicrostepCruiseStepUs (per
+// half-step) instead. Ramps keep the same acceleration in either mode.
+enum class MotorDrive : uint8_t { kHalfStep, kMicrostep };
+static constexpr MotorDrive kMotorDrive = MotorDrive::kHalfStep;
+static constexpr int kMotorMicrosteps = 8;
+static constexpr uint32_t kMotorMicrostepCruiseStepUs = 400;
+static constexpr uint32_t kMotorPwmHz = 20000;
+static constexpr uint8_t kMotorPwmBits = 10;
+static constexpr uint8_t kMotorPwmFirstChannel = 0;
+
+// Homing: without a trusted resting position at boot, the needle is driven
+// down kMotorHomeSteps half-steps (more than the X27.168's whole 315 degree
+// travel, a quarter degree each) at one per kMotorHomeStepUs, slow enough to
+// stall gently against the stop, which becomes position 0. A position the
+// needle has rested at for kNeedleCommitMs is saved to NVS. Saving it, and
+// marking it stale before the next move, each cost a flash write, so the
+// wait is minutes: the needle moves every few minutes while a pet is active,
+// and only a power cut before it has settled again costs a homing run.
+static constexpr int kMotorHomeSteps = 1280;
+static constexpr uint32_t kMotorHomeStepUs = 1000;
+static constexpr uint32_t kNeedleCommitMs = 600000;
+
+// Needle animation (needle_anim.h): readings are smoothed with gain
+// 1/2^kNeedleSmoothShift, changes under kNeedleDeadbandSteps (1% of the
+// dial) are ignored, and the needle eases to each new value over
+// kNeedleEaseMs, retargeted every kNeedleTickMs.
+static constexpr uint8_t kNeedleSmoothShift = 1;
+static constexpr int32_t kNeedleDeadbandSteps = 6;
+static constexpr uint32_t kNeedleEaseMs = 1200;
+static constexpr uint32_t kNeedleTickMs = 40;
 
 #endif
@@ -0,0 +1,144 @@
+#ifndef DISPLAY_DAILY_STATS_H
+#define DISPLAY_DAILY_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "tag_table.h"
+
+namespace daily {
+
+static constexpr uint32_t kSecondsPerDay = 86400;
+static constexpr uint32_t kSecondsPerHour = 3600;
+static constexpr size_t kHours = 24;
+static constexpr size_t kClasses = 3;  // resting, walking, high activity
+
+// Running totals for one calendar day. Hour buckets hold at most 3600 s, so
+// they fit 16 bits.
+struct Day {
+  uint32_t day;  // days since the clock's epoch
+  uint32_t class_s[kClasses];
+  uint32_t near_s;
+  uint16_t hour_active_s[kHours];  // walking + high activity
+  uint16_t hour_near_s[kHours];
+
+  uint32_t activeSeconds() const { return class_s[1] + class_s[2]; }
+};
+
+// Per-tag accumulator. Each scored window is credited with the time since
+// the tag's previous window, so totals stay right however long the tag
+// slept. Duplicates (not tags::newerRecord(), the tag table's rule) are
+// ignored; a gap of lost windows is credited to the class of the next one
+// received, up to maxSpanS per missing window. Time near the display is credited separately,
+// as stretches that may overlap ones already credited. Days live in a ring of
+// D slots indexed by day number: rolling over to a new day just clears one
+// slot.
+template <size_t D>
+class Tracker {
+ public:
+  // `firstSpanS`: credit for a tag's first window (its nominal cadence).
+  void begin(uint32_t tagId, uint32_t firstSpanS) {
+    *this = Tracker();
+    tag_id_ = tagId;
+    first_span_s_ = firstSpanS;
+  }
+
+  uint32_t tagId() const { return tag_id_; }
+
+  // Credits the window `seq` of boot `epoch` that ended at `t_s` (clock
+  // seconds). `maxSpanS` is the most one window can stand for: the tag's
+  // longest sleep in the power tier it reported.
+  void add(uint8_t epoch, uint32_t seq, uint32_t t_s, uint8_t activityClass, uint32_t maxSpanS) {
+    uint32_t span_s = first_span_s_;
+    if (have_last_) {
+      if (!tags::newerRecord(last_epoch_, last_seq_, epoch, seq)) {
+        return;
+      }
+      // After a tag restart (new epoch) its window gets firstSpanS.
+      if (epoch == last_epoch_) {
+        const uint32_t elapsed_s = t_s > last_t_s_ ? t_s - last_t_s_ : 0;
+        const uint64_t cap_s = static_cast<uint64_t>(seq - last_seq_) * maxSpanS;
+        span_s = elapsed_s < cap_s ? elapsed_s : static_cast<uint32_t>(cap_s);
+      }
+    }
+    have_last_ = true;
+    last_epoch_ = epoch;
+    last_seq_ = seq;
+    last_t_s_ = t_s;
+    const uint8_t c = activityClass < kClasses ? activityClass : 0;
+    forEachHour(t_s - (span_s < t_s ? span_s : t_s), t_s, [c](Day& d, size_t hour, uint32_t piece_s) {
+      d.class_s[c] += piece_s;
+      if (c != 0) {
+        d.hour_active_s[hour] = static_cast<uint16_t>(d.hour_active_s[hour] + piece_s);
+      }
+    });
+  }
+
+  // Credits [from_s, to_s) as time near the display, minus any part already
+  // credited.
+  void addNear(uint32_t from_s, uint32_t to_s) {
+    if (from_s < near_to_s_) {
+      from_s = near_to_s_;
+    }
+    if (from_s >= to_s) {
+      return;
+    }
+    near_to_s_ = to_s;
+    forEachHour(from_s, to_s, [](Day& d, size_t hour, uint32_t piece_s) {
+      d.near_s += piece_s;
+      d.hour_near_s[hour] = static_cast<uint16_t>(d.hour_near_s[hour] + piece_s);
+    });
+  }
+
+  // Totals for `day`, or nullptr if nothing was credited to it (or it has
+  // fallen out of the ring).
+  const Day* day(uint32_t dayNumber) const {
+    const Day& d = days_[dayNumber % D];
+    return used_[dayNumber % D] && d.day == dayNumber ? &d : nullptr;
+  }
+
+ private:
+  // Calls fn(day, hour, seconds) for each hour piece of [from_s, to_s). A span
+  // is at most a few sleep periods, so this loops a bounded, small number of
+  // times.
+  template <typename Fn>
+  void forEachHour(uint32_t from_s, uint32_t to_s, Fn fn) {
+    while (from_s < to_s) {
+      const uint32_t hour_end_s = (from_s / kSecondsPerHour + 1) * kSecondsPerHour;
+      const uint32_t piece_end_s = hour_end_s < to_s ? hour_end_s : to_s;
+      const uint32_t piece_s = piece_end_s - from_s;
+      Day* d = slot(from_s / kSecondsPerDay);
+      if (d != nullptr) {
+        fn(*d, (from_s % kSecondsPerDay) / kSecondsPerHour, piece_s);
+      }
+      from_s = piece_end_s;
+    }
+  }
+
+  // The slot for `dayNumber`, cleared if it still holds an older day; nullptr
+  // if a newer day already owns it (the span is too old to keep).
+  Day* slot(uint32_t dayNumber) {
+    Day& d = days_[dayNumber % D];
+    bool& used = used_[dayNumber % D];
+    if (!used || d.day < dayNumber) {
+      d = Day();
+      d.day = dayNumber;
+      used = true;
+    }
+    return d.day == dayNumber ? &d : nullptr;
+  }
+
+  Day days_[D];
+  bool used_[D];
+  uint32_t tag_id_;
+  uint32_t first_span_s_;
+  uint32_t last_seq_;
+  uint32_t last_t_s_;
+  uint8_t last_epoch_;
+  uint32_t near_to_s_;
+  bool have_last_;
+};
+
+}  // namespace daily
+
+#endif
@@ -1,7 +1,9 @@
 #ifndef DISPLAY_LED_STATUS_H
 #define DISPLAY_LED_STATUS_H
 
-#include <Arduino.h>
+#include <stdint.h>
+
+#include "hal/gpio.h"
 #include "pins.h"
 
 namespace led_status {
@@ -10,16 +12,17 @@ inline bool init() {
   if (PIN_STATUS_LED < 0) {
     return false;
   }
-  pinMode(PIN_STATUS_LED, OUTPUT);
-  digitalWrite(PIN_STATUS_LED, LOW);
+  hal::gpio::configure(PIN_STATUS_LED, hal::gpio::Mode::kOutput);
+  hal::gpio::write(PIN_STATUS_LED, false);
   return true;
 }
 
-inline void setFromActivity(uint16_t activity) {
+// On while a pet is near the display.
+inline void setNear(bool near) {
   if (PIN_STATUS_LED < 0) {
     return;
   }
-  digitalWrite(PIN_STATUS_LED, activity > 50 ? HIGH : LOW);
+  hal::gpio::write(PIN_STATUS_LED, near);
 }
 
 }  // namespace led_status
@@ -1,9 +1,16 @@
 #ifndef DISPLAY_MOTOR_GAUGE_H
 #define DISPLAY_MOTOR_GAUGE_H
 
-#include <Arduino.h>
+#include <math.h>
+#include <stdint.h>
 
 #include "config.h"
+#include "hal/console.h"
+#include "hal/critical.h"
+#include "hal/events.h"
+#include "hal/gpio.h"
+#include "hal/pwm.h"
+#include "hal/timer.h"
 #include "pins.h"
 
 namespace motor_gauge {
@@ -20,8 +27,50 @@ constexpr uint8_t kHalfStepSeq[8][4] = {
     {0, 0, 0, 1},
     {1, 0, 0, 1},
 };
+// Delay before the first step of a move started from rest.
+constexpr uint32_t kKickUs = 20;
+
+constexpr bool kMicrostepping = kMotorDrive == MotorDrive::kMicrostep;
+// Engine positions count microsteps; the public API counts half-steps.
+constexpr int kMicrosteps = kMicrostepping ? kMotorMicrosteps : 1;
+static_assert((kMicrosteps & (kMicrosteps - 1)) == 0, "kMotorMicrosteps must be a power of two");
+// Electrical phases per cycle: 8 half-steps of kMicrosteps each, so a
+// quarter wave (90 degrees) spans 2 * kMicrosteps.
+constexpr int kPhases = 8 * kMicrosteps;
+constexpr int kQuarterWave = 2 * kMicrosteps;
+constexpr int kRampTableSize = kMotorMaxRampSteps * kMicrosteps;
+static_assert(kRampTableSize <= 0xFFFF, "ramp index must fit in uint16_t");
+constexpr uint32_t kCruiseStepUs = kMicrostepping ? kMotorMicrostepCruiseStepUs : kMotorCruiseStepUs;
 }  // namespace
 
+// Motion state shared between setTarget() and the step timer ISR. `ramp`
+// indexes rampTable(): it also equals the number of steps needed to stop.
+// While `homing`, targets set are held in `pending` until the stop is found.
+struct Engine {
+  volatile int32_t pos;
+  volatile int32_t target;
+  volatile int32_t pending;
+  volatile int8_t dir;
+  volatile uint16_t ramp;
+  volatile bool running;
+  volatile bool homing;
+};
+
+// Where the needle last came to rest, in half-steps from the stop. The
+// engine clears `resting` before every move and sets it when one ends, so a
+// copy kept across a reset tells whether the needle is where it says.
+struct Rest {
+  uint32_t magic;  // kRestMagic once written by the engine
+  int32_t steps;
+  uint32_t resting;
+};
+
+constexpr uint32_t kRestMagic = 0x58323731;  // "X271"
+
+inline bool trusted(const Rest& rest) {
+  return rest.magic == kRestMagic && rest.resting != 0 && rest.steps >= 0 && rest.steps <= kGaugeMaxSteps;
+}
+
 inline bool& motorReady() {
   static bool ready = false;
   return ready;
@@ -32,12 +81,214 @@ inline int& currentStep() {
   return step;
 }
 
-inline int& currentPos() {
-  static int pos = 0;
-  return pos;
+inline Engine& engine() {
+  static Engine e = {0, 0, 0, 0, 0, false, false};
+  return e;
+}
+
+// Kept up to date by the engine; see init().
+inline Rest*& restRecord() {
+  static Rest* rest = nullptr;
+  return rest;
+}
+
+inline uint16_t* rampTable() {
+  static uint16_t table[kRampTableSize];
+  return table;
+}
+
+inline uint16_t& rampLength() {
+  static uint16_t len = 1;
+  return len;
+}
+
+// Half-step mode: the coil pins as one GPIO mask, and their levels for each
+// entry of kHalfStepSeq.
+inline uint32_t& coilMask() {
+  static uint32_t mask = 0;
+  return mask;
+}
+
+inline uint32_t* halfStepLevels() {
+  static uint32_t levels[8];
+  return levels;
+}
+
+// Microstep mode: PWM duty for sin(0..90 degrees) in kQuarterWave steps.
+inline uint16_t* sineTable() {
+  static uint16_t table[kQuarterWave + 1];
+  return table;
+}
+
+// Runs in the step ISR once a move ends at its target.
+inline hal::timer::Callback& settledCallback() {
+  static hal::timer::Callback callback = nullptr;
+  return callback;
+}
+
+inline int32_t currentPos() { return engine().pos / kMicrosteps; }
+inline int32_t targetPos() { return (engine().homing ? engine().pending : engine().target) / kMicrosteps; }
+inline bool isMoving() { return engine().running; }
+inline bool isHoming() { return engine().homing; }
+
+inline void HAL_ISR_ATTR recordRest(bool resting) {
+  Rest* rest = restRecord();
+  if (rest != nullptr) {
+    rest->magic = kRestMagic;
+    rest->steps = engine().pos / kMicrosteps;
+    rest->resting = resting ? 1 : 0;
+  }
+}
+
+// Step intervals for constant acceleration using the integer recurrence
+// c[n] = c[n-1] - 2 c[n-1] / (4n + 1) (D. Austin, "Generate stepper-motor
+// speed profiles in real time"), so the ISR only does a table lookup. In
+// microsteps the same acceleration is kMicrosteps times as many steps per
+// s^2, which scales the start interval by 1 / sqrt(kMicrosteps). Intervals
+// are kept in 1/256 us so the decrement does not round to zero on long ramps.
+inline void buildRamp() {
+  uint16_t* table = rampTable();
+  const uint32_t cruise = (kCruiseStepUs << 8) / kMicrosteps;
+  uint32_t c = static_cast<uint32_t>((kMotorStartStepUs << 8) / sqrt(static_cast<double>(kMicrosteps)));
+  uint16_t n = 0;
+  table[0] = static_cast<uint16_t>(c >> 8);
+  while (n + 1 < kRampTableSize && c > cruise) {
+    ++n;
+    c -= (2 * c) / (4 * n + 1);
+    if (c < cruise) {
+      c = cruise;
+    }
+    table[n] = static_cast<uint16_t>(c >> 8);
+  }
+  rampLength() = static_cast<uint16_t>(n + 1);
+}
+
+inline void buildPhaseTables() {
+  uint32_t mask = 0;
+  for (int i = 0; i < 4; ++i) {
+    mask |= hal::gpio::pinMask(kPins[i]);
+  }
+  coilMask() = mask;
+  for (int s = 0; s < 8; ++s) {
+    uint32_t levels = 0;
+    for (int i = 0; i < 4; ++i) {
+      if (kHalfStepSeq[s][i] != 0) {
+        levels |= hal::gpio::pinMask(kPins[i]);
+      }
+    }
+    halfStepLevels()[s] = levels;
+  }
+  const double full = static_cast<double>(1UL << kMotorPwmBits);
+  for (int k = 0; k <= kQuarterWave; ++k) {
+    sineTable()[k] = static_cast<uint16_t>(full * sin(k * (M_PI / 2) / kQuarterWave) + 0.5);
+  }
+}
+
+// Signed PWM duty for sin(2 pi * phase / kPhases).
+inline int32_t HAL_ISR_ATTR sineDuty(int phase) {
+  const int r = phase % kQuarterWave;
+  switch (phase / kQuarterWave) {
+    case 0:
+      return sineTable()[r];
+    case 1:
+      return sineTable()[kQuarterWave - r];
+    case 2:
+      return -static_cast<int32_t>(sineTable()[r]);
+    default:
+      return -static_cast<int32_t>(sineTable()[kQuarterWave - r]);
+  }
+}
+
+inline void HAL_ISR_ATTR writeCoil(uint8_t channel, int32_t duty) {
+  hal::pwm::write(kMotorPwmFirstChannel + channel, duty > 0 ? static_cast<uint32_t>(duty) : 0);
+  hal::pwm::write(kMotorPwmFirstChannel + channel + 2, duty < 0 ? static_cast<uint32_t>(-duty) : 0);
 }
 
-inline bool init() {
+// kHalfStepSeq energizes coil A through IN1 (+) / IN3 (-) and coil B through
+// IN2 (+) / IN4 (-), 45 degrees per half-step. Microstepping follows the
+// same cycle with A = cos and B = sin; each duty latches at the end of its
+// PWM period, so all four normally change together.
+inline void HAL_ISR_ATTR applyPhase(int phase) {
+  if (kMicrostepping) {
+    writeCoil(0, sineDuty((phase + kQuarterWave) & (kPhases - 1)));
+    writeCoil(1, sineDuty(phase));
+  } else {
+    hal::gpio::writeMasked(coilMask(), halfStepLevels()[phase]);
+  }
+}
+
+inline void HAL_ISR_ATTR stepMotor(int dir) {
+  currentStep() = (currentStep() + (dir > 0 ? 1 : kPhases - 1)) & (kPhases - 1);
+  applyPhase(currentStep());
+}
+
+// Step timer ISR: plans and takes exactly one (micro)step, then re-arms for
+// the next one. Speeds up while the target is further away than the braking
+// distance, slows down otherwise, and only reverses once back at start speed,
+// so a retarget mid-move never outruns the rotor. Homing steps at a constant
+// kMotorHomeStepUs instead.
+inline void HAL_ISR_ATTR onStepTimer() {
+  Engine& e = engine();
+  const int32_t target = e.target;
+  if (e.dir == 0 && target != e.pos) {
+    // Starting from rest: head for the target, never away from it.
+    e.dir = (target > e.pos) ? 1 : -1;
+  }
+  int32_t ahead = (e.dir >= 0) ? target - e.pos : e.pos - target;
+
+  if (ahead == 0 && e.homing) {
+    // Against the stop: positions are real from here on.
+    e.homing = false;
+    e.dir = 0;
+    e.target = e.pending;
+    if (e.target != e.pos) {
+      hal::timer::armUs(kKickUs);
+      return;
+    }
+  }
+  if (ahead <= 0) {
+    if (e.ramp > 0) {
+      // Target is behind us: brake in the current direction first.
+      --e.ramp;
+      e.pos += e.dir;
+      stepMotor(e.dir);
+      hal::timer::armUs(rampTable()[e.ramp]);
+      return;
+    }
+    if (ahead == 0) {
+      e.dir = 0;
+      e.running = false;
+      hal::events::holdAwake(false);
+      recordRest(true);
+      if (settledCallback() != nullptr) {
+        settledCallback()();
+      }
+      return;
+    }
+    e.dir = (e.dir > 0) ? -1 : 1;
+    ahead = -ahead;
+  }
+
+  if (e.homing) {
+    e.pos += e.dir;
+    stepMotor(e.dir);
+    hal::timer::armUs(kMotorHomeStepUs / kMicrosteps);
+    return;
+  }
+  if (ahead - 1 > e.ramp && e.ramp + 1 < rampLength()) {
+    ++e.ramp;
+  } else if (ahead - 1 < e.ramp) {
+    --e.ramp;
+  }
+  e.pos += e.dir;
+  stepMotor(e.dir);
+  hal::timer::armUs(rampTable()[e.ramp]);
+}
+
+// `onSettled` (optional) runs in the step ISR whenever the needle comes to
+// rest at its target. `rest` (optional) is kept up to date with every move;
+// the needle starts at an assumed 0 until restore() or home().
+inline bool init(hal::timer::Callback onSettled = nullptr, Rest* rest = nullptr) {
   for (int i = 0; i < 4; ++i) {
     if (kPins[i] < 0) {
       return false;
@@ -45,30 +296,99 @@ inline bool init() {
   }
 
   for (int i = 0; i < 4; ++i) {
-    pinMode(kPins[i], OUTPUT);
-    digitalWrite(kPins[i], LOW);
+    if (kMicrostepping) {
+      // Channels 0/2 drive coil A, 1/3 coil B; see applyPhase().
+      if (!hal::pwm::attach(kMotorPwmFirstChannel + i, kPins[i], kMotorPwmHz, kMotorPwmBits)) {
+        return false;
+      }
+    } else {
+      hal::gpio::configure(kPins[i], hal::gpio::Mode::kOutput);
+      hal::gpio::write(kPins[i], false);
+    }
+  }
+
+  if (!hal::timer::begin(onStepTimer)) {
+    return false;
   }
+  buildRamp();
+  buildPhaseTables();
 
+  Engine& e = engine();
+  e.pos = 0;
+  e.target = 0;
+  e.pending = 0;
+  e.dir = 0;
+  e.ramp = 0;
+  e.running = false;
+  e.homing = false;
+  settledCallback() = onSettled;
+  restRecord() = rest;
   motorReady() = true;
   currentStep() = 0;
-  currentPos() = 0;
   return true;
 }
 
-inline void applyStep(uint8_t seqIndex) {
-  for (int i = 0; i < 4; ++i) {
-    digitalWrite(kPins[i], kHalfStepSeq[seqIndex][i]);
+// Takes the needle to be resting at `steps`, e.g. from a saved Rest. The
+// electrical phase follows the position, so the next move picks up where
+// the rotor was left.
+inline bool restore(int32_t steps) {
+  if (!motorReady() || steps < 0 || steps > kGaugeMaxSteps) {
+    return false;
+  }
+  hal::CriticalSection lock;
+  Engine& e = engine();
+  if (e.running) {
+    return false;
   }
+  e.pos = steps * kMicrosteps;
+  e.target = e.pos;
+  currentStep() = e.pos & (kPhases - 1);
+  recordRest(true);
+  return true;
 }
 
-inline void stepMotor(int dir) {
-  if (dir > 0) {
-    currentStep() = (currentStep() + 1) & 0x07;
+// Starts driving the needle against its zero stop; see kMotorHomeSteps.
+// setTarget() calls meanwhile take effect once it is there, and onSettled
+// runs when the needle comes to rest.
+inline bool home() {
+  if (!motorReady()) {
+    return false;
+  }
+  hal::CriticalSection lock;
+  Engine& e = engine();
+  if (e.running) {
+    return false;
+  }
+  e.pos = kMotorHomeSteps * kMicrosteps;
+  e.pending = e.target;
+  e.target = 0;
+  e.dir = 0;
+  e.ramp = 0;
+  currentStep() = e.pos & (kPhases - 1);
+  recordRest(false);
+  e.homing = true;
+  e.running = true;
+  hal::events::holdAwake(true);
+  hal::timer::armUs(kKickUs);
+  return true;
+}
+
+// Cuts the coil current while the needle is at rest; the X27's gear train
+// holds it in place. The next move energizes the following phase directly.
+inline void release() {
+  if (!motorReady()) {
+    return;
+  }
+  hal::CriticalSection lock;
+  if (engine().running) {
+    return;
+  }
+  if (kMicrostepping) {
+    writeCoil(0, 0);
+    writeCoil(1, 0);
   } else {
-    currentStep() = (currentStep() + 7) & 0x07;
+    hal::gpio::writeMasked(coilMask(), 0);
   }
-  applyStep(static_cast<uint8_t>(currentStep()));
-  delayMicroseconds(kMotorStepDelayUs);
 }
 
 inline int clampTarget(int raw) {
@@ -81,7 +401,9 @@ inline int clampTarget(int raw) {
   return raw;
 }
 
-inline void setTargetFromActivity(uint16_t activity) {
+// Retargets the needle and returns immediately; the step timer does the
+// move in the background.
+inline void setTarget(int steps) {
   if (!motorReady()) {
     static bool warned = false;
     if (!warned) {
@@ -91,19 +413,28 @@ inline void setTargetFromActivity(uint16_t activity) {
     return;
   }
 
-  const uint16_t clamped = (activity > 100) ? 100 : activity;
-  const int target = clampTarget((clamped * kGaugeMaxSteps) / 100);
-
-  while (currentPos() < target) {
-    stepMotor(+1);
-    ++currentPos();
+  const int32_t target = clampTarget(steps) * kMicrosteps;
+  hal::CriticalSection lock;
+  Engine& e = engine();
+  if (e.homing) {
+    e.pending = target;
+    return;
   }
-  while (currentPos() > target) {
-    stepMotor(-1);
-    --currentPos();
+  e.target = target;
+  if (!e.running && target != e.pos) {
+    recordRest(false);
+    e.running = true;
+    hal::events::holdAwake(true);
+    hal::timer::armUs(kKickUs);
   }
 }
 
+// Gauge position for an activity level of 0-100.
+inline int stepsForActivity(uint16_t activity) {
+  const uint16_t clamped = (activity > 100) ? 100 : activity;
+  return (clamped * kGaugeMaxSteps) / 100;
+}
+
 }  // namespace motor_gauge
 
 #endif
@@ -0,0 +1,101 @@
+#ifndef DISPLAY_NEEDLE_ANIM_H
+#define DISPLAY_NEEDLE_ANIM_H
+
+#include <stdint.h>
+
+#include "config.h"
+
+namespace needle {
+
+// Cosine ease-in-out, 0 to 1 in Q15 at 32 even steps of the segment's time.
+constexpr uint16_t kEase[33] = {
+    0,     79,    315,   705,   1247,  1935,  2761,  3719,  4799,  5990,  7282,
+    8661,  10114, 11628, 13188, 14778, 16384, 17990, 19580, 21140, 22654, 24107,
+    25486, 26778, 27969, 29049, 30007, 30833, 31521, 32063, 32453, 32689, 32768,
+};
+
+// kEase at `t_q15` (0 to 32768), linearly interpolated.
+inline int32_t ease(uint32_t t_q15) {
+  if (t_q15 >= 32768) {
+    return 32768;
+  }
+  const uint32_t i = t_q15 >> 10;
+  const int32_t frac = static_cast<int32_t>(t_q15 & 1023);
+  return kEase[i] + (((kEase[i + 1] - kEase[i]) * frac) >> 10);
+}
+
+// Sits between the readings and the stepper, so the needle neither twitches
+// with noisy scores nor waits on the payload rate. Readings feed an
+// exponential average (gain 1/2^kNeedleSmoothShift, in 1/16 steps). Once it
+// is kNeedleDeadbandSteps or more from where the needle is headed, a segment
+// starts from the needle's current position and eases there over
+// kNeedleEaseMs; tick() gives the position along it every kNeedleTickMs.
+struct Animator {
+  int32_t filtered_q4;
+  int32_t from;
+  int32_t to;
+  int32_t shown;  // last position handed to the stepper
+  uint32_t start_ms;
+  uint32_t tick_ms;
+  bool seeded;
+  bool active;
+
+  // The needle rests at `steps`; the next reading is taken as is.
+  void begin(int32_t steps) {
+    from = to = shown = steps;
+    filtered_q4 = steps * 16;
+    seeded = false;
+    active = false;
+  }
+
+  // Drops the smoothing history, e.g. when the gauge changes what it shows.
+  void restart() { seeded = false; }
+
+  // Feeds one reading; returns true if it starts a new segment.
+  bool setGoal(int32_t steps, uint32_t now_ms) {
+    if (!seeded) {
+      filtered_q4 = steps * 16;
+      seeded = true;
+    } else {
+      filtered_q4 += (steps * 16 - filtered_q4) >> kNeedleSmoothShift;
+    }
+    const int32_t goal = (filtered_q4 + 8) >> 4;
+    const int32_t change = goal > to ? goal - to : to - goal;
+    if (change < kNeedleDeadbandSteps) {
+      return false;
+    }
+    from = shown;
+    to = goal;
+    start_ms = now_ms;
+    tick_ms = now_ms - kNeedleTickMs;
+    active = true;
+    return true;
+  }
+
+  // Time left until tick() is due; UINT32_MAX while at rest.
+  uint32_t msUntilTick(uint32_t now_ms) const {
+    if (!active) {
+      return UINT32_MAX;
+    }
+    const uint32_t since_ms = now_ms - tick_ms;
+    return since_ms < kNeedleTickMs ? kNeedleTickMs - since_ms : 0;
+  }
+
+  // Position along the segment at `now_ms`; ends the segment at its end.
+  int32_t tick(uint32_t now_ms) {
+    tick_ms = now_ms;
+    const uint32_t elapsed_ms = now_ms - start_ms;
+    if (elapsed_ms >= kNeedleEaseMs) {
+      shown = to;
+      active = false;
+    } else {
+      const uint32_t t_q15 = static_cast<uint32_t>((static_cast<uint64_t>(elapsed_ms) << 15) / kNeedleEaseMs);
+      shown = from + (((to - from) * ease(t_q15)) >> 15);
+    }
+    return shown;
+  }
+};
+
+}  // namespace needle
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef DISPLAY_PINS_H
 #define DISPLAY_PINS_H
 
+#include "hal/gpio.h"
+
 // X27.168 motor wiring (current connection):
 // left-top -> D1, left-bottom -> D0, right-top -> D2, right-bottom -> D3
 static constexpr int PIN_MOTOR_IN1 = D1;
@@ -14,4 +16,8 @@ static constexpr int PIN_MOTOR_IN4 = D3;
 // Optional status LED pin. Keep -1 if unused.
 static constexpr int PIN_STATUS_LED = -1;
 
+// Optional push button to GND (internal pull-up); cycles the gauge source.
+// Keep -1 if unused.
+static constexpr int PIN_BUTTON = -1;
+
 #endif
@@ -0,0 +1,88 @@
+#ifndef DISPLAY_PROXIMITY_H
+#define DISPLAY_PROXIMITY_H
+
+#include <stdint.h>
+
+#include "config.h"
+#include "hal/ble.h"
+
+namespace proximity {
+
+// RSSI smoother with a near/far decision, run on every packet inside the BLE
+// callbacks: a handful of integer adds and shifts, no floats.
+//
+// The level is an exponential average in 1/16 dBm. Its gain starts at 1 and
+// halves with every sample down to 1/2^kRssiFilterShift, so, like a scalar
+// Kalman filter, it locks on within a few packets and then holds a steady
+// gain. Each innovation is clamped to +/-kRssiMaxStepDb first, so one faded
+// packet cannot flip the state. Near/far has hysteresis: near at or above
+// kNearEnterDbm, away again only below kNearExitDbm.
+struct Estimator {
+  int16_t level_q4;
+  uint8_t shift;
+  bool seeded;
+  bool near;
+
+  void update(int8_t rssi) {
+    const int16_t sample_q4 = static_cast<int16_t>(rssi * 16);
+    if (!seeded) {
+      level_q4 = sample_q4;
+      seeded = true;
+    } else {
+      const int16_t max_step_q4 = kRssiMaxStepDb * 16;
+      int16_t step_q4 = static_cast<int16_t>(sample_q4 - level_q4);
+      step_q4 = step_q4 > max_step_q4 ? max_step_q4 : (step_q4 < -max_step_q4 ? -max_step_q4 : step_q4);
+      if (shift < kRssiFilterShift) {
+        ++shift;
+      }
+      level_q4 = static_cast<int16_t>(level_q4 + (step_q4 >> shift));
+    }
+    if (level_q4 >= kNearEnterDbm * 16) {
+      near = true;
+    } else if (level_q4 < kNearExitDbm * 16) {
+      near = false;
+    }
+  }
+
+  int8_t dbm() const { return static_cast<int8_t>(level_q4 >> 4); }
+};
+
+// A tag's proximity over time, on the display clock. A near stretch runs from
+// the packet that found the tag near to the newest packet still near. Packets
+// more than `maxGapS` apart (the tag's longest silence in its power tier, see
+// kNearMaxGapS) end the stretch and restart the filter: the pet may have
+// been away in between.
+struct Presence {
+  Estimator rssi;
+  bool heard;
+  uint32_t heard_s;
+  uint32_t max_gap_s;  // as of the newest packet
+  uint32_t near_from_s;
+  uint32_t near_to_s;
+
+  void hear(int8_t rssiDbm, uint32_t now_s, uint32_t maxGapS) {
+    if (rssiDbm == hal::ble::kRssiUnknown) {
+      return;
+    }
+    if (heard && now_s - heard_s > maxGapS) {
+      rssi = Estimator();
+    }
+    heard = true;
+    heard_s = now_s;
+    max_gap_s = maxGapS;
+    const bool was_near = rssi.near;
+    rssi.update(rssiDbm);
+    if (rssi.near) {
+      if (!was_near) {
+        near_from_s = now_s;
+      }
+      near_to_s = now_s;
+    }
+  }
+
+  bool nearAt(uint32_t now_s) const { return heard && rssi.near && now_s - heard_s <= max_gap_s; }
+};
+
+}  // namespace proximity
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef DISPLAY_SPSC_RING_H
+#define DISPLAY_SPSC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+namespace spsc {
+
+// Bounded lock-free ring between exactly one producer (the BLE stack's task)
+// and one consumer (the main loop). Each index is written by one side only,
+// so plain acquire/release loads and stores suffice; the ESP32-C3 has no
+// atomic read-modify-write instructions and none are needed. A full ring
+// rejects the new item and counts it instead of overwriting: the consumer
+// owns the oldest slot.
+template <typename T, size_t N>
+class Ring {
+  static_assert(N != 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+ public:
+  Ring() : head_(0), tail_(0), dropped_(0), high_water_(0) {}
+
+  static constexpr size_t capacity() { return N; }
+
+  // Producer only.
+  bool push(const T& item) {
+    const uint32_t head = head_.load(std::memory_order_relaxed);
+    const uint32_t tail = tail_.load(std::memory_order_acquire);
+    if (head - tail == N) {
+      dropped_.store(dropped_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return false;
+    }
+    items_[head & (N - 1)] = item;
+    head_.store(head + 1, std::memory_order_release);
+    if (head + 1 - tail > high_water_.load(std::memory_order_relaxed)) {
+      high_water_.store(head + 1 - tail, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  // Consumer only.
+  bool pop(T* out) {
+    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+    const uint32_t head = head_.load(std::memory_order_acquire);
+    if (head == tail) {
+      return false;
+    }
+    *out = items_[tail & (N - 1)];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Items rejected because the ring was full, since construction.
+  uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+  // Most items ever queued at once.
+  uint32_t highWater() const { return high_water_.load(std::memory_order_relaxed); }
+
+ private:
+  T items_[N];
+  std::atomic<uint32_t> head_;  // next slot to fill; producer-owned
+  std::atomic<uint32_t> tail_;  // next slot to drain; consumer-owned
+  std::atomic<uint32_t> dropped_;
+  std::atomic<uint32_t> high_water_;
+};
+
+}  // namespace spsc
+
+#endif
@@ -0,0 +1,186 @@
+#ifndef DISPLAY_TAG_TABLE_H
+#define DISPLAY_TAG_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal/ble.h"
+#include "proximity.h"
+
+namespace tags {
+
+// Adverts repeat within a burst and GATT batches are resent after a failed
+// delivery; only records newer than the tag's last accepted one count. A tag
+// that boots from reset restarts its seq at 0 under a new boot epoch, and
+// any record from another epoch starts the sequence afresh.
+inline bool newerRecord(uint8_t lastEpoch, uint32_t lastSeq, uint8_t epoch, uint32_t seq) {
+  return epoch != lastEpoch || static_cast<int32_t>(seq - lastSeq) > 0;
+}
+
+// Latest state of one sensor tag, keyed by its BLE address.
+struct Tag {
+  hal::ble::Address address;
+  uint32_t id;  // unique per table slot assignment, never reused
+  bool in_use;
+  bool have_seq;
+  uint8_t boot_epoch;  // of last_seq
+  uint32_t last_seq;
+  uint32_t seen_ms;  // when the newest accepted window was scored
+  uint16_t battery_mv;
+  uint8_t activity;
+  uint8_t activity_class;
+  uint8_t power_tier;  // protocol::PowerTier the tag reported last
+  proximity::Presence presence;
+
+  bool acceptSeq(uint8_t epoch, uint32_t seq) {
+    if (have_seq && !newerRecord(boot_epoch, last_seq, epoch, seq)) {
+      return false;
+    }
+    have_seq = true;
+    boot_epoch = epoch;
+    last_seq = seq;
+    return true;
+  }
+
+  bool fresh(uint32_t now_ms, uint32_t maxAgeMs) const {
+    return in_use && have_seq && now_ms - seen_ms <= maxAgeMs;
+  }
+};
+
+// Fixed table of the tags heard so far. Lookups are a linear scan over N
+// (a handful of pets); a new tag takes a free slot or evicts the one heard
+// from least recently.
+template <size_t N>
+struct Table {
+  Tag entries[N];
+  uint32_t next_id;
+
+  static constexpr size_t capacity() { return N; }
+
+  Tag* find(const hal::ble::Address& address) {
+    for (Tag& tag : entries) {
+      if (tag.in_use && hal::ble::sameAddress(tag.address, address)) {
+        return &tag;
+      }
+    }
+    return nullptr;
+  }
+
+  Tag& findOrAdd(const hal::ble::Address& address, uint32_t now_ms) {
+    Tag* tag = find(address);
+    if (tag != nullptr) {
+      return *tag;
+    }
+    Tag* slot = &entries[0];
+    for (Tag& candidate : entries) {
+      if (!candidate.in_use) {
+        slot = &candidate;
+        break;
+      }
+      if (now_ms - candidate.seen_ms > now_ms - slot->seen_ms) {
+        slot = &candidate;
+      }
+    }
+    *slot = Tag();
+    slot->address = address;
+    slot->id = ++next_id;
+    slot->in_use = true;
+    slot->seen_ms = now_ms;
+    return *slot;
+  }
+
+  size_t index(const Tag& tag) const { return static_cast<size_t>(&tag - entries); }
+};
+
+// How per-tag gauge readings combine into one needle position.
+enum class Aggregate : uint8_t {
+  kMean,
+  kMax,
+};
+
+inline uint16_t combine(const uint16_t* values, size_t n, Aggregate mode) {
+  uint32_t sum = 0;
+  uint16_t peak = 0;
+  for (size_t i = 0; i < n; ++i) {
+    sum += values[i];
+    peak = values[i] > peak ? values[i] : peak;
+  }
+  if (n == 0) {
+    return 0;
+  }
+  return mode == Aggregate::kMax ? peak : static_cast<uint16_t>((sum + n / 2) / n);
+}
+
+// Tags linked over GATT before, newest first, with the attribute handles
+// discovery resolved for them. Persisted as-is (hal::storage), so a reboot
+// or a dropped link reconnects without discovery; bump kLinkCacheVersion
+// when the layout changes.
+static constexpr uint8_t kLinkCacheVersion = 1;
+
+struct CachedLink {
+  hal::ble::Address address;
+  hal::ble::GattHandles handles;
+  uint8_t valid;
+};
+
+template <size_t N>
+struct LinkCache {
+  uint8_t version;
+  CachedLink links[N];
+
+  void clear() { *this = LinkCache(); version = kLinkCacheVersion; }
+
+  // Slot of `address`, or N if it is not cached.
+  size_t indexOf(const hal::ble::Address& address) const {
+    for (size_t i = 0; i < N; ++i) {
+      if (links[i].valid && hal::ble::sameAddress(links[i].address, address)) {
+        return i;
+      }
+    }
+    return N;
+  }
+
+  const CachedLink* find(const hal::ble::Address& address) const {
+    const size_t i = indexOf(address);
+    return i < N ? &links[i] : nullptr;
+  }
+
+  // Records `handles` for `address`. A new tag goes to the front, dropping
+  // the oldest entry if full; a known one is updated in place so relinking
+  // does not rewrite flash. Returns true if anything changed.
+  bool remember(const hal::ble::Address& address, const hal::ble::GattHandles& handles) {
+    const size_t known = indexOf(address);
+    if (known < N) {
+      hal::ble::GattHandles& cached = links[known].handles;
+      const bool same = cached.value == handles.value && cached.cccd == handles.cccd;
+      cached = handles;
+      return !same;
+    }
+    size_t from = N - 1;
+    for (size_t i = 0; i < N; ++i) {
+      if (!links[i].valid) {
+        from = i;
+        break;
+      }
+    }
+    for (size_t i = from; i > 0; --i) {
+      links[i] = links[i - 1];
+    }
+    links[0].address = address;
+    links[0].handles = handles;
+    links[0].valid = 1;
+    return true;
+  }
+
+  size_t size() const {
+    size_t n = 0;
+    for (const CachedLink& link : links) {
+      n += link.valid ? 1 : 0;
+    }
+    return n;
+  }
+};
+
+}  // namespace tags
+
+#endif
@@ -1,13 +1,17 @@
-#include <Arduino.h>
-#include <BLEDevice.h>
+#include <cstddef>
 #include <cstring>
 
-#include "ble_protocol.h"
 #include "config.h"
+#include "daily_stats.h"
+#include "hal/hal.h"
 #include "led_status.h"
 #include "motor_gauge.h"
+#include "needle_anim.h"
 #include "pins.h"
 #include "power_stages.h"
+#include "protocol/activity_batch.h"
+#include "spsc_ring.h"
+#include "tag_table.h"
 
 enum class DisplayState {
   BOOT,
@@ -19,40 +23,146 @@ enum class DisplayState {
 
 namespace {
 
-class DisplayClientCallbacks : public BLEClientCallbacks {
- public:
-  void onConnect(BLEClient* /*client*/) override {}
-
-  void onDisconnect(BLEClient* /*client*/) override {
-    Serial.println("BLE disconnected.");
-    connected_ = false;
-  }
-
-  bool connected() const { return connected_; }
-  void setConnected(bool value) { connected_ = value; }
+DisplayState g_state = DisplayState::BOOT;
 
- private:
-  bool connected_ = false;
+// Posted to hal::events; WAIT_FOR_DATA blocks until one arrives.
+enum class Event : uint8_t {
+  kData,          // records queued in g_rx_ring
+  kProximity,     // a tag crossed the near/far threshold
+  kLinkDown,      // a GATT link dropped
+  kButton,
+  kMotorSettled,  // the needle reached its target
 };
 
-DisplayState g_state = DisplayState::BOOT;
-DisplayClientCallbacks g_client_callbacks;
-BLEClient* g_client = nullptr;
-BLERemoteCharacteristic* g_remote_char = nullptr;
+// Records decoded by the BLE callbacks, consumed by UPDATE_DISPLAY.
+struct RxRecord {
+  protocol::ActivityRecord record;
+  uint32_t rx_s;    // display clock when the frame arrived
+  uint32_t tag_id;  // Tag::id, to spot a slot reassigned meanwhile
+  uint8_t tag;      // index into g_tags
+};
 
-ActivityPayload g_last_payload{};
-volatile bool g_payload_ready = false;
+// A frame carries at most about ten records, so the ring takes a few frames
+// back to back before the main loop drains it.
+constexpr size_t kRxRingCapacity = 32;
+spsc::Ring<RxRecord, kRxRingCapacity> g_rx_ring;
+// g_rx_ring.dropped() as of the last report; main loop only.
+uint32_t g_rx_dropped_reported = 0;
+// Frames from another protocol version, or malformed ones.
+uint32_t g_rx_rejected = 0;
+// Power tier last reported per g_tags slot; main loop only.
+uint8_t g_tier_shown[kMaxTags] = {};
 uint32_t g_wait_start_ms = 0;
 
+// Per-tag state, written by the BLE callbacks under a CriticalSection.
+tags::Table<kMaxTags> g_tags;
+// Daily totals, one tracker per g_tags slot; only the main loop touches them.
+daily::Tracker<kHistoryDays> g_daily[kMaxTags];
+// GATT: links to open at once, when the last discovery scan ran, whether
+// known tags are still unlinked and the links up after the last scan.
+constexpr size_t kLinkBudget = kMaxTags < hal::ble::kMaxLinks ? kMaxTags : hal::ble::kMaxLinks;
+bool g_discovered = false;
+uint32_t g_last_discovery_ms = 0;
+bool g_scan_again = false;
+size_t g_links_seen = 0;
+// Address and handles of tags linked before, loaded from and saved to NVS.
+constexpr const char* kLinkCacheKey = "tag_links";
+tags::LinkCache<kMaxTags> g_link_cache;
+
 bool g_motor_ready = false;
+// Where the needle last came to rest. motor_gauge keeps the RTC copy, which
+// survives software resets but not power loss; it is committed to NVS only
+// once the needle has rested kNeedleCommitMs, to spare the flash.
+HAL_RTC_NOINIT motor_gauge::Rest g_needle_rtc;
+constexpr const char* kNeedleKey = "needle";
+motor_gauge::Rest g_needle_saved = {};  // as last saved to NVS
+uint32_t g_needle_settled_ms = 0;
+needle::Animator g_needle;
+// Last reading fed to g_needle: its average only steps on new data.
+uint16_t g_needle_reading = 0;
 bool g_ble_initialized = false;
-
-void notifyCallback(BLERemoteCharacteristic* /*remote*/, uint8_t* data, size_t len, bool /*isNotify*/) {
-  if (len < sizeof(ActivityPayload)) {
+// What the needle shows; the button cycles through the sources.
+GaugeSource g_gauge_source = kGaugeSource;
+uint32_t g_last_press_ms = 0;
+
+void postEvent(Event event) { hal::events::post(static_cast<uint8_t>(event)); }
+
+// Decodes one batch frame from `from` into its tag's state and g_rx_ring,
+// oldest record first, and feeds the frame's RSSI to the tag's proximity
+// filter. Runs in the BLE stack's task, the ring's only producer: only the
+// tag-table writes are masked, records go through the ring lock-free. If the
+// ring is full a record is dropped; the daily totals credit its time to the
+// tag's next record.
+void onBatchFrame(const hal::ble::Address& from, int8_t rssi, const uint8_t* data, size_t len) {
+  const protocol::ActivityBatchView batch(data, len);
+  if (!batch.valid()) {
+    hal::CriticalSection lock;
+    ++g_rx_rejected;
     return;
   }
-  memcpy(&g_last_payload, data, sizeof(ActivityPayload));
-  g_payload_ready = true;
+
+  const uint32_t now_ms = hal::clock::millis();
+  const uint32_t now_s = hal::clock::rtcSeconds();
+  // Only this task adds or evicts tags, so `tag` stays put between sections.
+  tags::Tag* tag = nullptr;
+  bool proximity_changed = false;
+  {
+    hal::CriticalSection lock;
+    tag = &g_tags.findOrAdd(from, now_ms);
+    const bool was_near = tag->presence.rssi.near;
+    tag->presence.hear(rssi, now_s, kNearMaxGapS * protocol::tierQuietScale(batch.powerTier()));
+    proximity_changed = tag->presence.rssi.near != was_near;
+  }
+
+  RxRecord out = {};
+  out.rx_s = now_s;
+  out.tag_id = tag->id;
+  out.tag = static_cast<uint8_t>(g_tags.index(*tag));
+  bool queued = false;
+  protocol::ActivityBatchView::Iterator it = batch.records();
+  while (it.next(out.record)) {
+    const protocol::ActivityRecord& rec = out.record;
+    bool accepted = false;
+    {
+      hal::CriticalSection lock;
+      accepted = tag->acceptSeq(rec.boot_epoch, rec.seq);
+      if (accepted) {
+        // Records arrive oldest first, so the last accepted one is the newest.
+        tag->activity = rec.activity;
+        tag->activity_class = rec.activity_class;
+        tag->battery_mv = rec.battery_mv;
+        tag->power_tier = rec.power_tier;
+        tag->seen_ms = now_ms - (rec.age_s > now_ms / 1000 ? now_ms : rec.age_s * 1000);
+      }
+    }
+    if (accepted && g_rx_ring.push(out)) {
+      queued = true;
+    }
+  }
+
+  // Posting may wake the main task, so never from inside a critical section.
+  if (queued) {
+    postEvent(Event::kData);
+  }
+  if (proximity_changed) {
+    postEvent(Event::kProximity);
+  }
+}
+
+void notifyCallback(const hal::ble::Address& from, int8_t rssi, const uint8_t* data, size_t len) {
+  onBatchFrame(from, rssi, data, len);
+}
+
+void advertCallback(const hal::ble::Address& from, int8_t rssi, const uint8_t* data, size_t len) {
+  onBatchFrame(from, rssi, data, len);
+}
+
+void linkDownCallback(const hal::ble::Address& /*peer*/) { postEvent(Event::kLinkDown); }
+
+void HAL_ISR_ATTR onButtonIsr() { hal::events::postFromIsr(static_cast<uint8_t>(Event::kButton)); }
+
+void HAL_ISR_ATTR onMotorSettledIsr() {
+  hal::events::postFromIsr(static_cast<uint8_t>(Event::kMotorSettled));
 }
 
 bool validatePins() {
@@ -80,171 +190,617 @@ bool ensureBleInit() {
   if (g_ble_initialized) {
     return true;
   }
-  BLEDevice::init(kBleDeviceName);
-  g_ble_initialized = true;
-  return true;
+  g_ble_initialized = hal::ble::init(kBleDeviceName);
+  return g_ble_initialized;
 }
 
-bool connectToSensor() {
-  if (!ensureBleInit()) {
+bool listenForSensor() {
+  if (!hal::ble::scanning() &&
+      !hal::ble::startPassiveScan(kBleAdvCompanyId, kBleAdvScanIntervalMs, advertCallback)) {
+    Serial.println("BLE passive scan failed to start.");
     return false;
   }
+  g_wait_start_ms = hal::clock::millis();
+  return true;
+}
 
-  BLEScan* scan = BLEDevice::getScan();
-  scan->setActiveScan(true);
-  BLEScanResults results = scan->start(kBleScanSeconds, false);
+// Logs why a connect attempt failed; returns true if it succeeded.
+bool reportConnect(hal::ble::ConnectResult result) {
+  switch (result) {
+    case hal::ble::ConnectResult::kOk:
+      return true;
+    case hal::ble::ConnectResult::kConnectFailed:
+      Serial.println("BLE connect failed.");
+      return false;
+    case hal::ble::ConnectResult::kServiceMissing:
+      Serial.println("BLE service missing on peer.");
+      return false;
+    case hal::ble::ConnectResult::kCharacteristicMissing:
+      Serial.println("BLE characteristic missing on peer.");
+      return false;
+    case hal::ble::ConnectResult::kNotifyUnsupported:
+      Serial.println("BLE characteristic does not support notify.");
+      return false;
+    case hal::ble::ConnectResult::kCccdMissing:
+      Serial.println("BLE CCCD descriptor not found on peer.");
+      return false;
+    case hal::ble::ConnectResult::kSubscribeFailed:
+      Serial.println("BLE notify subscription failed.");
+      return false;
+    case hal::ble::ConnectResult::kNoFreeLink:
+      Serial.println("BLE: no free link for another tag.");
+      return false;
+  }
+  return false;
+}
 
-  BLEAdvertisedDevice* target = nullptr;
-  for (int i = 0; i < results.getCount(); ++i) {
-    BLEAdvertisedDevice device = results.getDevice(i);
-    if (device.haveServiceUUID() && device.isAdvertisingService(BLEUUID(BLE_SERVICE_UUID))) {
-      target = new BLEAdvertisedDevice(device);
-      break;
-    }
+void loadLinkCache() {
+  if (!hal::storage::load(kLinkCacheKey, &g_link_cache, sizeof(g_link_cache)) ||
+      g_link_cache.version != tags::kLinkCacheVersion) {
+    g_link_cache.clear();
   }
+  Serial.print("BLE: ");
+  Serial.print(static_cast<unsigned int>(g_link_cache.size()));
+  Serial.println(" cached tag link(s).");
+}
 
-  scan->clearResults();
+void rememberLink(const hal::ble::Address& target, const hal::ble::GattHandles& handles) {
+  if (g_link_cache.remember(target, handles) &&
+      !hal::storage::save(kLinkCacheKey, &g_link_cache, sizeof(g_link_cache))) {
+    Serial.println("BLE: could not save the tag link cache.");
+  }
+}
 
-  if (target == nullptr) {
-    Serial.println("BLE scan: target service not found.");
-    return false;
+// Clears the NVS copy's resting flag before the needle leaves it, so a power
+// cut mid-move is not taken for a known position.
+void markNeedleMoving() {
+  if (!motor_gauge::trusted(g_needle_saved)) {
+    return;
+  }
+  g_needle_saved.resting = 0;
+  if (!hal::storage::save(kNeedleKey, &g_needle_saved, sizeof(g_needle_saved))) {
+    Serial.println("Needle: could not save its position.");
   }
+}
 
-  if (g_client == nullptr) {
-    g_client = BLEDevice::createClient();
-    g_client->setClientCallbacks(&g_client_callbacks);
+// Puts the needle where it last rested: from RTC memory after a software
+// reset, from NVS after a power cycle, or by homing if neither is trusted.
+void startNeedle() {
+  if (!hal::storage::load(kNeedleKey, &g_needle_saved, sizeof(g_needle_saved))) {
+    g_needle_saved = motor_gauge::Rest();
+  }
+  const bool from_rtc = motor_gauge::trusted(g_needle_rtc);
+  const motor_gauge::Rest rest = from_rtc ? g_needle_rtc : g_needle_saved;
+  if (motor_gauge::trusted(rest) && motor_gauge::restore(rest.steps)) {
+    Serial.print("Needle: resting at ");
+    Serial.print(rest.steps);
+    Serial.println(from_rtc ? " (RTC memory)." : " (NVS).");
+    g_needle_settled_ms = hal::clock::millis();
+    return;
   }
+  Serial.println("Needle: position unknown; homing.");
+  markNeedleMoving();
+  motor_gauge::home();
+}
 
-  if (!g_client->connect(target)) {
-    Serial.println("BLE connect failed.");
-    delete target;
-    return false;
+// Saves where the needle rests once it has stayed there kNeedleCommitMs.
+void commitNeedle() {
+  motor_gauge::Rest rest;
+  {
+    hal::CriticalSection lock;
+    rest = g_needle_rtc;
+  }
+  if (!motor_gauge::trusted(rest) || hal::clock::millis() - g_needle_settled_ms < kNeedleCommitMs ||
+      (motor_gauge::trusted(g_needle_saved) && g_needle_saved.steps == rest.steps)) {
+    return;
   }
-  delete target;
-  delay(500);  // Allow GATT attribute discovery to complete
+  if (!hal::storage::save(kNeedleKey, &rest, sizeof(rest))) {
+    Serial.println("Needle: could not save its position.");
+    return;
+  }
+  g_needle_saved = rest;
+  Serial.print("Needle: saved resting position ");
+  Serial.println(rest.steps);
+}
 
-  BLERemoteService* service = g_client->getService(BLEUUID(BLE_SERVICE_UUID));
-  if (service == nullptr) {
-    Serial.println("BLE service missing on peer.");
-    g_client->disconnect();
-    return false;
+// Opens a link to one tag. A tag linked before is subscribed through its
+// cached handles, skipping discovery; if the handles are stale (the tag's
+// firmware changed) it is rediscovered and the cache updated.
+bool connectTag(const hal::ble::Address& target) {
+  const tags::CachedLink* cached = g_link_cache.find(target);
+  if (cached != nullptr) {
+    const hal::ble::GattHandles handles = cached->handles;
+    const hal::ble::ConnectResult result = hal::ble::connectCached(target, handles, notifyCallback);
+    if (result == hal::ble::ConnectResult::kOk) {
+      rememberLink(target, handles);
+      return true;
+    }
+    if (result != hal::ble::ConnectResult::kSubscribeFailed) {
+      return reportConnect(result);
+    }
+    Serial.println("BLE: cached handles rejected; rediscovering.");
   }
 
-  g_remote_char = service->getCharacteristic(BLEUUID(BLE_CHAR_UUID));
-  if (g_remote_char == nullptr) {
-    Serial.println("BLE characteristic missing on peer.");
-    g_client->disconnect();
+  hal::ble::GattHandles handles = {};
+  if (!reportConnect(hal::ble::connect(target, kBleServiceUuid, kBleCharUuid, notifyCallback, &handles))) {
     return false;
   }
+  rememberLink(target, handles);
+  return true;
+}
 
-  if (!g_remote_char->canNotify()) {
-    Serial.println("BLE characteristic does not support notify.");
-    g_client->disconnect();
+// Advertising: one passive scan hears every tag. GATT: a reconnect scan ends
+// at the first unlinked tag it sees, which is linked at once, and repeats
+// straight away while known tags are missing (shouldRescan()). Every
+// kTagRescanMs a discovery scan instead looks for all missing links at once
+// to pick up new tags. Returns true if at least one tag can deliver data.
+bool connectToSensors() {
+  if (!ensureBleInit()) {
     return false;
   }
+  if (kBleTransport == BleTransport::kAdvertising) {
+    return listenForSensor();
+  }
 
-  BLERemoteDescriptor* cccd =
-      g_remote_char->getDescriptor(BLEUUID((uint16_t)0x2902));
-  if (cccd == nullptr) {
-    Serial.println("BLE CCCD descriptor not found on peer.");
-    g_client->disconnect();
-    return false;
+  const uint32_t start_ms = hal::clock::millis();
+  const bool discover = !g_discovered || start_ms - g_last_discovery_ms >= kTagRescanMs;
+  const size_t missing = kLinkBudget - hal::ble::centralLinks();
+  hal::ble::Address found[kLinkBudget];
+  const size_t n = hal::ble::scanForService(kBleServiceUuid, kBleScanSeconds, found, discover ? missing : 1);
+  if (discover) {
+    g_discovered = true;
+    g_last_discovery_ms = hal::clock::millis();
+  }
+  if (n == 0) {
+    Serial.println("BLE scan: target service not found.");
+  }
+  size_t linked = 0;
+  for (size_t i = 0; i < n && hal::ble::centralLinks() < kLinkBudget; ++i) {
+    if (!hal::ble::centralConnected(found[i]) && connectTag(found[i])) {
+      ++linked;
+    }
   }
 
-  if (!g_remote_char->registerForNotify(notifyCallback)) {
-    Serial.println("BLE notify subscription failed.");
-    g_client->disconnect();
+  // Scan straight on only while tags linked before are still missing.
+  const size_t links = hal::ble::centralLinks();
+  const size_t known = g_link_cache.size() < kLinkBudget ? g_link_cache.size() : kLinkBudget;
+  g_scan_again = linked != 0 && links < known;
+  g_links_seen = links;
+  if (links == 0) {
     return false;
   }
-
-  g_client_callbacks.setConnected(true);
-  g_wait_start_ms = millis();
+  if (linked != 0) {
+    Serial.print("BLE: linked ");
+    Serial.print(static_cast<unsigned int>(linked));
+    Serial.print(" tag(s) in ");
+    Serial.print(hal::clock::millis() - start_ms);
+    Serial.print(" ms; ");
+    Serial.print(static_cast<unsigned int>(links));
+    Serial.println(" linked in total.");
+  }
+  g_wait_start_ms = hal::clock::millis();
   return true;
 }
 
 bool isBleConnected() {
-  if (g_client == nullptr) {
+  if (kBleTransport == BleTransport::kAdvertising) {
+    return hal::ble::scanning();
+  }
+  return hal::ble::centralLinks() > 0;
+}
+
+// GATT with spare links: scan again right away after a link drops or while
+// known tags are missing, and every kTagRescanMs to discover new tags.
+bool shouldRescan() {
+  if (kBleTransport != BleTransport::kGatt) {
     return false;
   }
-  return g_client->isConnected() && g_client_callbacks.connected();
+  const size_t links = hal::ble::centralLinks();
+  const bool dropped = links < g_links_seen;
+  g_links_seen = links;
+  return links < kLinkBudget &&
+         (dropped || g_scan_again || hal::clock::millis() - g_last_discovery_ms >= kTagRescanMs);
+}
+
+const char* activityClassName(uint8_t c) {
+  static const char* const kNames[] = {"resting", "walking", "high"};
+  return c < sizeof(kNames) / sizeof(kNames[0]) ? kNames[c] : "?";
+}
+
+const char* powerTierName(uint8_t tier) {
+  static const char* const kNames[] = {"normal", "saver", "critical"};
+  return tier < sizeof(kNames) / sizeof(kNames[0]) ? kNames[tier] : "?";
+}
+
+// Credits one received window to its tag's daily totals. O(1): a window
+// touches at most a couple of hour buckets.
+void accumulate(const RxRecord& rx) {
+  daily::Tracker<kHistoryDays>& tracker = g_daily[rx.tag];
+  if (tracker.tagId() != rx.tag_id) {
+    tracker.begin(rx.tag_id, kTagWindowSpanS);
+  }
+  const uint32_t t_s = rx.rx_s > rx.record.age_s ? rx.rx_s - rx.record.age_s : 0;
+  // The view only passes valid tiers.
+  const protocol::PowerTier tier = static_cast<protocol::PowerTier>(rx.record.power_tier);
+  tracker.add(rx.record.boot_epoch, rx.record.seq, t_s, rx.record.activity_class,
+              kTagMaxWindowSpanS * protocol::tierScale(tier).sleep);
+}
+
+// Today's seconds as a 0-100 share of `goalMinutes`.
+uint16_t goalPercent(uint32_t seconds, uint32_t goalMinutes) {
+  const uint32_t percent = seconds * 100UL / (goalMinutes * 60UL);
+  return static_cast<uint16_t>(percent > 100 ? 100 : percent);
+}
+
+uint16_t gaugeReading(const tags::Tag& tag, const daily::Day* today) {
+  switch (g_gauge_source) {
+    case GaugeSource::kLatestActivity:
+      return tag.activity;
+    case GaugeSource::kActiveToday:
+      return today != nullptr ? goalPercent(today->activeSeconds(), kActiveGoalMinutes) : 0;
+    case GaugeSource::kNearToday:
+      return today != nullptr ? goalPercent(today->near_s, kNearGoalMinutes) : 0;
+  }
+  return 0;
+}
+
+const char* gaugeSourceName() {
+  switch (g_gauge_source) {
+    case GaugeSource::kLatestActivity:
+      return "activity ";
+    case GaugeSource::kActiveToday:
+      return "active today ";
+    case GaugeSource::kNearToday:
+      return "near today ";
+  }
+  return "";
 }
 
-void updateDisplayFromPayload() {
-  const uint16_t activity = (g_last_payload.activity > 100) ? 100 : g_last_payload.activity;
+// The LED is on while any tag is near. Also called from IDLE, so it goes out
+// once a near tag falls silent for longer than its tier's near gap.
+void updateNearLed() {
+  const uint32_t now_s = hal::clock::rtcSeconds();
+  bool near = false;
+  {
+    hal::CriticalSection lock;
+    for (const tags::Tag& tag : g_tags.entries) {
+      near = near || (tag.in_use && tag.presence.nearAt(now_s));
+    }
+  }
+  led_status::setNear(near);
+}
+
+void printDailyHistograms() {
+  const uint32_t day = hal::clock::rtcSeconds() / daily::kSecondsPerDay;
+  for (size_t t = 0; t < kMaxTags; ++t) {
+    const daily::Day* today = g_daily[t].day(day);
+    if (today == nullptr) {
+      continue;
+    }
+    Serial.print("Day ");
+    Serial.print(day);
+    Serial.print(" tag=");
+    Serial.print(static_cast<unsigned int>(t));
+    Serial.println(" hour active_s near_s");
+    for (size_t h = 0; h < daily::kHours; ++h) {
+      if (today->hour_active_s[h] == 0 && today->hour_near_s[h] == 0) {
+        continue;
+      }
+      Serial.print("  ");
+      Serial.print(static_cast<unsigned int>(h));
+      Serial.print(" ");
+      Serial.print(today->hour_active_s[h]);
+      Serial.print(" ");
+      Serial.println(today->hour_near_s[h]);
+    }
+  }
+}
+
+void updateDisplayFromQueue() {
+  tags::Tag snapshot[kMaxTags];
+  uint32_t rejected = 0;
+  {
+    hal::CriticalSection lock;
+    memcpy(snapshot, g_tags.entries, sizeof(snapshot));
+    rejected = g_rx_rejected;
+    g_rx_rejected = 0;
+  }
+  if (rejected != 0) {
+    Serial.print("RX: ignored ");
+    Serial.print(rejected);
+    Serial.println(" frame(s) with an unknown protocol version or bad layout.");
+  }
+  const uint32_t dropped = g_rx_ring.dropped();
+  if (dropped != g_rx_dropped_reported) {
+    Serial.print("RX: ring full, dropped ");
+    Serial.print(dropped - g_rx_dropped_reported);
+    Serial.print(" record(s); high water ");
+    Serial.print(g_rx_ring.highWater());
+    Serial.print("/");
+    Serial.println(static_cast<unsigned int>(kRxRingCapacity));
+    g_rx_dropped_reported = dropped;
+  }
+
+  RxRecord rx;
+  size_t received = 0;
+  while (g_rx_ring.pop(&rx)) {
+    const protocol::ActivityRecord& r = rx.record;
+    ++received;
+    accumulate(rx);
+    Serial.print("RX tag=");
+    Serial.print(static_cast<unsigned int>(rx.tag));
+    Serial.print(" seq=");
+    Serial.print(r.seq);
+    Serial.print(" activity=");
+    Serial.print(r.activity);
+    Serial.print(" class=");
+    Serial.print(activityClassName(r.activity_class));
+    Serial.print(" battery_mv=");
+    Serial.print(r.battery_mv);
+    Serial.print(" tier=");
+    Serial.print(powerTierName(r.power_tier));
+    Serial.print(" age_s=");
+    Serial.println(r.age_s);
+  }
 
-  Serial.print("RX seq=");
-  Serial.print(g_last_payload.seq);
-  Serial.print(" activity=");
-  Serial.print(activity);
-  Serial.print(" battery_mv=");
-  Serial.println(g_last_payload.battery_mv);
+  // Near stretches so far; the tracker skips what it already has.
+  for (size_t t = 0; t < kMaxTags; ++t) {
+    const proximity::Presence& presence = snapshot[t].presence;
+    if (snapshot[t].in_use && presence.heard && g_daily[t].tagId() == snapshot[t].id) {
+      g_daily[t].addNear(presence.near_from_s, presence.near_to_s);
+    }
+  }
+  updateNearLed();
+
+  // One reading per tag heard within kTagStaleMs (stretched for its power
+  // tier), straight from the running totals: no history is rescanned.
+  const uint32_t now_ms = hal::clock::millis();
+  const uint32_t now_s = hal::clock::rtcSeconds();
+  const uint32_t day = now_s / daily::kSecondsPerDay;
+  uint16_t readings[kMaxTags];
+  size_t fresh = 0;
+  for (size_t t = 0; t < kMaxTags; ++t) {
+    const protocol::PowerTier tier = static_cast<protocol::PowerTier>(snapshot[t].power_tier);
+    if (!snapshot[t].fresh(now_ms, kTagStaleMs * protocol::tierQuietScale(tier))) {
+      continue;
+    }
+    const daily::Day* today = g_daily[t].tagId() == snapshot[t].id ? g_daily[t].day(day) : nullptr;
+    readings[fresh++] = gaugeReading(snapshot[t], today);
+    const proximity::Presence& presence = snapshot[t].presence;
+    if (presence.heard) {
+      Serial.print("Proximity tag=");
+      Serial.print(static_cast<unsigned int>(t));
+      Serial.print(" rssi_dbm=");
+      Serial.print(presence.rssi.dbm());
+      Serial.println(presence.nearAt(now_s) ? " near" : " away");
+    }
+    // A tag low on battery sleeps longer and reports less often.
+    if (snapshot[t].power_tier != g_tier_shown[t]) {
+      Serial.print("Power tier tag=");
+      Serial.print(static_cast<unsigned int>(t));
+      Serial.print(" ");
+      Serial.print(powerTierName(snapshot[t].power_tier));
+      Serial.print(" battery_mv=");
+      Serial.println(snapshot[t].battery_mv);
+      g_tier_shown[t] = snapshot[t].power_tier;
+    }
+    if (today != nullptr) {
+      Serial.print("Today tag=");
+      Serial.print(static_cast<unsigned int>(t));
+      Serial.print(" active_min=");
+      Serial.print(today->activeSeconds() / 60);
+      Serial.print(" walking_min=");
+      Serial.print(today->class_s[1] / 60);
+      Serial.print(" high_min=");
+      Serial.print(today->class_s[2] / 60);
+      Serial.print(" near_min=");
+      Serial.println(today->near_s / 60);
+    }
+  }
+  if (fresh == 0) {
+    return;
+  }
 
+  const uint16_t reading =
+      tags::combine(readings, fresh, kGaugeShowsMax ? tags::Aggregate::kMax : tags::Aggregate::kMean);
+  Serial.print("Gauge: ");
+  Serial.print(gaugeSourceName());
+  Serial.print(reading);
+  Serial.print(kGaugeShowsMax ? " (max of " : " (mean of ");
+  Serial.print(static_cast<unsigned int>(fresh));
+  Serial.println(" tag(s))");
   if (g_motor_ready) {
-    motor_gauge::setTargetFromActivity(activity);
+    // Proximity events and button presses also land here; repeating the
+    // same reading would tighten the needle's smoothing with event traffic.
+    const bool changed = received != 0 || reading != g_needle_reading || !g_needle.seeded;
+    g_needle_reading = reading;
+    if (changed && g_needle.setGoal(motor_gauge::stepsForActivity(reading), hal::clock::millis())) {
+      markNeedleMoving();
+    }
   } else {
     Serial.println("Motor pins not configured; display update is print-only.");
   }
-  led_status::setFromActivity(activity);
+}
+
+// Debounced; returns true if the press switched the gauge source.
+bool onButtonPress() {
+  const uint32_t now_ms = hal::clock::millis();
+  if (now_ms - g_last_press_ms < kButtonDebounceMs) {
+    return false;
+  }
+  g_last_press_ms = now_ms;
+  switch (g_gauge_source) {
+    case GaugeSource::kLatestActivity:
+      g_gauge_source = GaugeSource::kActiveToday;
+      break;
+    case GaugeSource::kActiveToday:
+      g_gauge_source = GaugeSource::kNearToday;
+      break;
+    case GaugeSource::kNearToday:
+      g_gauge_source = GaugeSource::kLatestActivity;
+      break;
+  }
+  g_needle.restart();
+  Serial.print("Button: gauge shows ");
+  Serial.println(gaugeSourceName());
+  return true;
+}
+
+void initButton() {
+  if (PIN_BUTTON < 0) {
+    return;
+  }
+  hal::gpio::configure(PIN_BUTTON, hal::gpio::Mode::kInputPullup);
+  if (!hal::gpio::attachInterrupt(PIN_BUTTON, hal::gpio::Edge::kFalling, onButtonIsr)) {
+    Serial.println("WARNING: button cannot wake the display from light sleep.");
+  }
+}
+
+// Hands the stepper the needle's next position when a tick is due. Coils are
+// released once the animation and the move it ends have both finished.
+void animateNeedle() {
+  const uint32_t now_ms = hal::clock::millis();
+  if (!g_motor_ready || g_needle.msUntilTick(now_ms) != 0) {
+    return;
+  }
+  motor_gauge::setTarget(g_needle.tick(now_ms));
+  if (!g_needle.active && !motor_gauge::isMoving()) {
+    motor_gauge::release();
+  }
+}
+
+// How long WAIT_FOR_DATA may block: until kDataWaitTimeoutMs after it began
+// or, over GATT with spare links, until the next discovery scan is due.
+uint32_t waitTimeoutMs() {
+  const uint32_t now_ms = hal::clock::millis();
+  const uint32_t waited_ms = now_ms - g_wait_start_ms;
+  uint32_t timeout_ms = waited_ms < kDataWaitTimeoutMs ? kDataWaitTimeoutMs - waited_ms : 0;
+  if (kBleTransport == BleTransport::kGatt && hal::ble::centralLinks() < kLinkBudget) {
+    const uint32_t since_ms = now_ms - g_last_discovery_ms;
+    const uint32_t until_ms = since_ms < kTagRescanMs ? kTagRescanMs - since_ms : 0;
+    timeout_ms = until_ms < timeout_ms ? until_ms : timeout_ms;
+  }
+  return timeout_ms;
+}
+
+void onEvent(Event event) {
+  switch (event) {
+    case Event::kData:
+    case Event::kProximity:
+      g_state = DisplayState::UPDATE_DISPLAY;
+      break;
+    case Event::kLinkDown:
+      // WAIT_FOR_DATA rechecks the links on its next pass.
+      break;
+    case Event::kButton:
+      if (onButtonPress()) {
+        g_state = DisplayState::UPDATE_DISPLAY;
+      }
+      break;
+    case Event::kMotorSettled:
+      g_needle_settled_ms = hal::clock::millis();
+      if (!g_needle.active) {
+        motor_gauge::release();
+      }
+      break;
+  }
 }
 
 }  // namespace
 
 void setup() {
   Serial.begin(115200);
-  delay(300);
+  hal::clock::delayMs(300);
 }
 
 void loop() {
+  if (Serial.available() > 0) {
+    const int command = Serial.read();
+    if (command == kTraceDumpCommand) {
+      trace::dump();
+    } else if (command == kDailyDumpCommand) {
+      printDailyHistograms();
+    }
+  }
+
   switch (g_state) {
     case DisplayState::BOOT:
+      trace::beginWake();
       validatePins();
-      g_motor_ready = motor_gauge::init();
+      if (!hal::events::begin()) {
+        Serial.println("ERROR: could not create the event queue.");
+      }
+      if (!hal::events::enableAutoLightSleep()) {
+        Serial.println("Automatic light sleep unavailable; waiting awake.");
+      }
+      g_motor_ready = motor_gauge::init(onMotorSettledIsr, &g_needle_rtc);
+      if (g_motor_ready) {
+        startNeedle();
+        g_needle.begin(motor_gauge::targetPos());
+      }
       led_status::init();
+      initButton();
+      if (kBleTransport == BleTransport::kGatt) {
+        hal::ble::setLinkDownHandler(linkDownCallback);
+        loadLinkCache();
+      }
       g_state = DisplayState::BLE_SCAN_CONNECT;
       break;
 
     case DisplayState::BLE_SCAN_CONNECT:
       LOG_STAGE("BLE_SCAN");
-      if (connectToSensor()) {
+      if (connectToSensors()) {
         LOG_STAGE("BLE_CONNECTED");
         g_state = DisplayState::WAIT_FOR_DATA;
       } else {
-        delay(400);
+        hal::clock::delayMs(400);
       }
       break;
 
-    case DisplayState::WAIT_FOR_DATA:
+    case DisplayState::WAIT_FOR_DATA: {
       if (!isBleConnected()) {
+        Serial.println("BLE disconnected.");
         g_state = DisplayState::BLE_SCAN_CONNECT;
         break;
       }
 
-      if (g_payload_ready) {
-        g_state = DisplayState::UPDATE_DISPLAY;
+      if (shouldRescan()) {
+        g_state = DisplayState::BLE_SCAN_CONNECT;
         break;
       }
 
-      if (millis() - g_wait_start_ms > kDataWaitTimeoutMs) {
-        g_state = DisplayState::IDLE;
+      animateNeedle();
+      const uint32_t timeout_ms = waitTimeoutMs();
+      const uint32_t tick_ms = g_needle.msUntilTick(hal::clock::millis());
+      uint8_t event = 0;
+      if (!hal::events::wait(&event, tick_ms < timeout_ms ? tick_ms : timeout_ms)) {
+        // A needle tick comes round again here; anything else idles.
+        if (tick_ms >= timeout_ms) {
+          g_state = DisplayState::IDLE;
+        }
+        break;
       }
-      delay(20);
+      onEvent(static_cast<Event>(event));
       break;
+    }
 
     case DisplayState::UPDATE_DISPLAY:
       LOG_STAGE("DISPLAY_UPDATE");
-      updateDisplayFromPayload();
-      g_payload_ready = false;
-      g_wait_start_ms = millis();
+      updateDisplayFromQueue();
+      g_wait_start_ms = hal::clock::millis();
       g_state = DisplayState::WAIT_FOR_DATA;
       break;
 
     case DisplayState::IDLE:
       LOG_STAGE("IDLE");
-      delay(kIdleDelayMs);
+      updateNearLed();
+      if (g_motor_ready) {
+        commitNeedle();
+      }
       if (!isBleConnected()) {
         g_state = DisplayState::BLE_SCAN_CONNECT;
       } else {
-        g_wait_start_ms = millis();
+        g_wait_start_ms = hal::clock::millis();
         g_state = DisplayState::WAIT_FOR_DATA;
       }
       break;
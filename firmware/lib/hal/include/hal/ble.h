@@ -0,0 +1,109 @@
+#ifndef HAL_BLE_H
+#define HAL_BLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace hal {
+namespace ble {
+
+struct Address {
+  uint8_t bytes[6];
+  uint8_t type;  // 0 = public, 1 = random (matches esp_ble_addr_type_t)
+};
+
+inline bool sameAddress(const Address& a, const Address& b) {
+  return a.type == b.type && memcmp(a.bytes, b.bytes, sizeof(a.bytes)) == 0;
+}
+
+// HCI's "RSSI not available" value.
+static constexpr int8_t kRssiUnknown = 127;
+
+// `from` is the peripheral that sent the notification. Reading a link's RSSI
+// takes a controller round trip, so `rssi` is the newest reading finished
+// before this notification (kRssiUnknown until the first one is in).
+using NotifyHandler = void (*)(const Address& from, int8_t rssi, const uint8_t* data, size_t len);
+// `peer` dropped its link, or it was lost, without disconnect() being called.
+using LinkDownHandler = void (*)(const Address& peer);
+// `data` is the manufacturer-specific AD payload after the company ID.
+using AdvertHandler = void (*)(const Address& from, int8_t rssi, const uint8_t* data, size_t len);
+
+// Longest notification at the default ATT MTU of 23.
+static constexpr size_t kMaxNotifyLen = 20;
+
+// Longest manufacturer payload that fits a legacy advert next to the flags
+// and company ID.
+static constexpr size_t kMaxBroadcastLen = 24;
+
+// Concurrent central links. The Arduino core's Bluedroid build allows four
+// ACL connections (CONFIG_BT_ACL_CONNECTIONS).
+static constexpr size_t kMaxLinks = 4;
+
+// Attribute handles of a peer's notify characteristic. connect() resolves
+// them through discovery; connectCached() reuses them to skip it.
+struct GattHandles {
+  uint16_t value;
+  uint16_t cccd;
+};
+
+enum class ConnectResult : uint8_t {
+  kOk,
+  kConnectFailed,
+  kServiceMissing,
+  kCharacteristicMissing,
+  kNotifyUnsupported,
+  kCccdMissing,
+  kSubscribeFailed,
+  kNoFreeLink,
+};
+
+bool init(const char* deviceName);
+void deinit();
+
+// Peripheral role: one service exposing one READ|NOTIFY characteristic,
+// advertised by service UUID until stopPeripheral().
+bool startPeripheral(const char* serviceUuid, const char* charUuid);
+bool peripheralConnected();
+bool notify(const uint8_t* data, size_t len);
+void stopPeripheral();
+
+// Broadcaster role: non-connectable adverts every `intervalMs` carrying
+// `data` as manufacturer-specific data under `companyId`.
+bool startBroadcast(uint16_t companyId, const uint8_t* data, size_t len, uint16_t intervalMs);
+void stopBroadcast();
+
+// Central role: active scan for at most `seconds`, returning distinct
+// advertisers of `serviceUuid`. The scan stops as soon as `maxOut` have been
+// seen, so asking for one returns within an advertising interval when a
+// peer is in range.
+size_t scanForService(const char* serviceUuid, uint32_t seconds, Address* out, size_t maxOut);
+// Opens one of kMaxLinks links to `peer`, discovers the characteristic and
+// subscribes `onNotify` to it. `onNotify` runs in the BLE stack's context.
+// On success the resolved handles are stored in `resolved` if given.
+ConnectResult connect(const Address& peer, const char* serviceUuid, const char* charUuid,
+                      NotifyHandler onNotify, GattHandles* resolved = nullptr);
+// Fast path for a known peer: connects and enables notifications by writing
+// `handles.cccd` directly, without service discovery. kSubscribeFailed means
+// the peer rejected the write (stale handles); fall back to connect().
+ConnectResult connectCached(const Address& peer, const GattHandles& handles, NotifyHandler onNotify);
+bool centralConnected(const Address& peer);
+// `onLinkDown` runs in the BLE stack's context; nullptr to stop.
+void setLinkDownHandler(LinkDownHandler onLinkDown);
+// Links currently up.
+size_t centralLinks();
+void disconnect(const Address& peer);
+void disconnectAll();
+
+// Observer role: continuous passive scan at 100% duty (`intervalMs` window
+// and interval), reporting every advert whose manufacturer data starts with
+// `companyId`, duplicates included. `onAdvert` runs in the BLE stack's
+// context.
+bool startPassiveScan(uint16_t companyId, uint16_t intervalMs, AdvertHandler onAdvert);
+bool scanning();
+void stopScan();
+
+}  // namespace ble
+}  // namespace hal
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef HAL_CLOCK_H
+#define HAL_CLOCK_H
+
+#include <stdint.h>
+
+namespace hal {
+namespace clock {
+
+uint32_t millis();
+uint32_t micros();
+void delayMs(uint32_t ms);
+void delayUs(uint32_t us);
+
+// Seconds on the RTC timer, which keeps counting through deep sleep (but
+// restarts from 0 on power-on).
+uint32_t rtcSeconds();
+
+}  // namespace clock
+}  // namespace hal
+
+#endif
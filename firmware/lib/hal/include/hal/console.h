@@ -0,0 +1,54 @@
+#ifndef HAL_CONSOLE_H
+#define HAL_CONSOLE_H
+
+#ifdef HAL_NATIVE
+
+#include <stdint.h>
+
+namespace hal {
+namespace sim {
+
+// Stand-in for the Arduino `Serial` object. Lines are written to stdout
+// prefixed with the virtual time (and the node, in multi-node runs).
+class Console {
+ public:
+  void begin(unsigned long /*baud*/) {}
+  void flush();
+  int available() { return 0; }
+  int read() { return -1; }
+
+  void print(const char* s);
+  void print(char c);
+  void print(int v) { print(static_cast<long long>(v)); }
+  void print(unsigned int v) { print(static_cast<unsigned long long>(v)); }
+  void print(long v) { print(static_cast<long long>(v)); }
+  void print(unsigned long v) { print(static_cast<unsigned long long>(v)); }
+  void print(long long v);
+  void print(unsigned long long v);
+  void print(double v, int digits = 2);
+
+  template <typename T>
+  void println(T v) {
+    print(v);
+    println();
+  }
+  void println(double v, int digits) {
+    print(v, digits);
+    println();
+  }
+  void println();
+
+ private:
+  void write(const char* s);
+};
+
+}  // namespace sim
+}  // namespace hal
+
+extern hal::sim::Console Serial;
+
+#else
+#include <Arduino.h>
+#endif
+
+#endif
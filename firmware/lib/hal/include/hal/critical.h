@@ -0,0 +1,21 @@
+#ifndef HAL_CRITICAL_H
+#define HAL_CRITICAL_H
+
+namespace hal {
+
+// Masks interrupts (timer callbacks on native) for state shared with an ISR.
+void enterCritical();
+void exitCritical();
+
+class CriticalSection {
+ public:
+  CriticalSection() { enterCritical(); }
+  ~CriticalSection() { exitCritical(); }
+
+  CriticalSection(const CriticalSection&) = delete;
+  CriticalSection& operator=(const CriticalSection&) = delete;
+};
+
+}  // namespace hal
+
+#endif
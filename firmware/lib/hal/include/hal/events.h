@@ -0,0 +1,45 @@
+#ifndef HAL_EVENTS_H
+#define HAL_EVENTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal/timer.h"
+
+namespace hal {
+namespace events {
+
+// One queue of small event codes from BLE-stack callbacks and ISRs to the
+// main task (a FreeRTOS queue on target). Events only say that something
+// happened; the data stays wherever the producer left it, so a dropped event
+// on a full queue loses no data as long as another one follows.
+static constexpr size_t kQueueDepth = 16;
+
+bool begin();
+
+// From task context, e.g. BLE-stack callbacks. Never blocks; returns false if
+// the queue is full. Not from inside a CriticalSection.
+bool post(uint8_t event);
+// From interrupt context (timer and GPIO callbacks).
+bool HAL_ISR_ATTR postFromIsr(uint8_t event);
+
+// Blocks the calling task until an event arrives (true) or `timeoutMs`
+// passes (false). With automatic light sleep on, the chip sleeps meanwhile.
+bool wait(uint8_t* event, uint32_t timeoutMs);
+
+// Lets the idle task light-sleep the chip whenever every task is blocked,
+// waking for timers, BLE connection events and GPIO wake pins. Returns false
+// if the SDK build lacks power management or tickless idle; wait() still
+// blocks, just without sleeping.
+bool enableAutoLightSleep();
+
+// Keeps automatic light sleep off between holdAwake(true) and the matching
+// holdAwake(false), e.g. while a timer ISR must fire on time: the chip only
+// wakes for the alarm after the sleep's wake-up latency. Calls nest. Safe
+// from interrupt context.
+void HAL_ISR_ATTR holdAwake(bool hold);
+
+}  // namespace events
+}  // namespace hal
+
+#endif
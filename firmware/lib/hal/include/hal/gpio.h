@@ -0,0 +1,64 @@
+#ifndef HAL_GPIO_H
+#define HAL_GPIO_H
+
+#include <stdint.h>
+
+#ifdef HAL_NATIVE
+// XIAO ESP32-C3 pad aliases normally provided by the Arduino variant.
+static constexpr int D0 = 2;
+static constexpr int D1 = 3;
+static constexpr int D2 = 4;
+static constexpr int D3 = 5;
+static constexpr int D4 = 6;
+static constexpr int D5 = 7;
+static constexpr int D6 = 21;
+static constexpr int D7 = 20;
+static constexpr int D8 = 8;
+static constexpr int D9 = 9;
+static constexpr int D10 = 10;
+#else
+#include <Arduino.h>  // D0..D10 pad aliases from the board variant
+#endif
+
+namespace hal {
+namespace gpio {
+
+enum class Mode : uint8_t {
+  kInput,
+  kInputPullup,
+  kOutput,
+};
+
+enum class Edge : uint8_t {
+  kFalling,
+  kRising,
+};
+
+// Runs in interrupt context; mark it HAL_ISR_ATTR (hal/timer.h).
+using IsrCallback = void (*)();
+
+void configure(int pin, Mode mode);
+void write(int pin, bool high);
+bool read(int pin);
+int analogRead(int pin);
+// Pin voltage in mV, corrected with the chip's factory ADC calibration
+// (eFuse); about +/-10 mV over 150-2450 mV at the default 11 dB attenuation,
+// against +/-100 mV or more for a raw reading scaled by hand.
+int analogReadMv(int pin);
+
+// Bit for `pin` in writeMasked() masks; 0 for an unset (negative) pin.
+inline uint32_t pinMask(int pin) { return pin >= 0 && pin < 32 ? 1UL << pin : 0; }
+
+// Drives every output pin in `mask` to its bit in `levels` with a single
+// register write, so they all switch on the same clock edge. Read-modify-
+// write of the whole port: call from an ISR or with interrupts masked.
+void writeMasked(uint32_t mask, uint32_t levels);
+
+// Calls `onEdge` on every `edge` at `pin`. The level the edge leads to also
+// wakes the chip from light sleep, so presses are not lost while it sleeps.
+bool attachInterrupt(int pin, Edge edge, IsrCallback onEdge);
+
+}  // namespace gpio
+}  // namespace hal
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef HAL_HAL_H
+#define HAL_HAL_H
+
+// Thin hardware abstraction shared by both firmwares. The Arduino backend
+// (src/arduino) forwards to the ESP32 core; building with -DHAL_NATIVE
+// selects the simulated Linux backend (src/native) instead.
+
+#include "hal/ble.h"
+#include "hal/clock.h"
+#include "hal/console.h"
+#include "hal/critical.h"
+#include "hal/events.h"
+#include "hal/gpio.h"
+#include "hal/i2c.h"
+#include "hal/pwm.h"
+#include "hal/sleep.h"
+#include "hal/storage.h"
+#include "hal/timer.h"
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef HAL_I2C_H
+#define HAL_I2C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace hal {
+namespace i2c {
+
+// Largest single read the backend can return in one transaction.
+static constexpr size_t kMaxReadLen = 128;
+
+bool begin(int sda, int scl, uint32_t hz);
+bool writeReg(uint8_t addr, uint8_t reg, uint8_t val);
+// Register read with a repeated start; `len` must not exceed kMaxReadLen.
+bool readRegs(uint8_t addr, uint8_t reg, uint8_t* out, size_t len);
+
+}  // namespace i2c
+}  // namespace hal
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef HAL_PWM_H
+#define HAL_PWM_H
+
+#include <stdint.h>
+
+namespace hal {
+namespace pwm {
+
+// Hardware PWM channels (LEDC on the ESP32-C3, which has six).
+static constexpr uint8_t kMaxChannels = 6;
+
+// Routes `channel` to `pin` at `hz` with `bits` of duty resolution, starting
+// at duty 0. Channels sharing a frequency and resolution may share a timer.
+bool attach(uint8_t channel, int pin, uint32_t hz, uint8_t bits);
+
+// Sets the duty (0 to 2^bits) from the channel's next period. Only touches
+// the channel's own registers, so it is safe from an ISR.
+void write(uint8_t channel, uint32_t duty);
+
+}  // namespace pwm
+}  // namespace hal
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef HAL_SIM_H
+#define HAL_SIM_H
+
+// Control surface of the native backend: virtual clock, event scheduling and
+// the simulated peripherals behind the I2C and BLE shims. Only available when
+// building with -DHAL_NATIVE.
+
+#ifndef HAL_NATIVE
+#error "hal/sim.h is only available in native builds"
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace hal {
+namespace sim {
+
+// ---- Virtual clock ----
+// Time only moves when firmware delays or sleeps (plus a small fixed cost per
+// loop() iteration), so runs are deterministic and much faster than real time.
+uint64_t nowUs();
+void advanceUs(uint64_t us);
+// As advanceUs(), but returns true as soon as an event leaves `pin` at
+// `level`, with the clock at that event. Used for deep-sleep GPIO wake.
+bool advanceUntilPin(uint64_t us, int pin, bool level);
+// As advanceUntilPin(), stopping once `stop(ctx)` returns true after an event.
+bool advanceUntil(uint64_t us, bool (*stop)(void* ctx), void* ctx);
+
+using EventFn = void (*)(void* ctx);
+// Runs `fn(ctx)` when the virtual clock reaches `atUs`, as the current node.
+void schedule(uint64_t atUs, EventFn fn, void* ctx);
+// As schedule(), running as `node`.
+void scheduleOn(size_t node, uint64_t atUs, EventFn fn, void* ctx);
+
+// Cost charged for every loop() pass so state machines that never delay still
+// make progress in virtual time.
+static constexpr uint64_t kLoopOverheadUs = 10;
+
+// ---- Nodes ----
+// A run simulates one device, node 0, unless a host such as
+// tools/sim_e2e.cpp adds more. Every node has its own pins, I2C bus and
+// LSM6DS3, radio, storage, event queue, alarm, console prefix and Stats; all
+// share the virtual clock and, through setAir(), the radio medium. The calls
+// in this header act on the current node: the one running, or the one whose
+// event is being run.
+static constexpr size_t kMaxNodes = 4;
+
+using EntryFn = void (*)();
+// Registers a firmware; the first call names node 0. Returns the node, or
+// kMaxNodes if there is no room.
+size_t addNode(const char* name, EntryFn setup, EntryFn loop);
+size_t nodeCount();
+size_t currentNode();
+const char* nodeName(size_t node);
+// Makes `node` current, for host setup before runNodes() and reports after.
+void selectNode(size_t node);
+// Runs every node's setup() and then loop() (each on its own stack) until
+// the virtual clock reaches `untilUs`. One node runs at a time, until it
+// delays, sleeps or waits; then whichever node or event is due earliest
+// goes next, so runs are deterministic. Call once.
+void runNodes(uint64_t untilUs);
+
+// ---- GPIO ----
+bool pinLevel(int pin);
+// Duty last written to PWM `channel`.
+uint32_t pwmDuty(uint8_t channel);
+// Drives an input; an edge runs the pin's attachInterrupt() callback.
+void setInputLevel(int pin, bool high);
+// Raw 12-bit reading; analogReadMv() scales it to kAdcFullScaleMv.
+void setAnalogValue(int pin, int raw);
+static constexpr int kAdcFullScaleMv = 2500;
+
+// ---- I2C ----
+class I2cDevice {
+ public:
+  virtual ~I2cDevice() {}
+  virtual bool writeReg(uint8_t reg, uint8_t val) = 0;
+  virtual bool readRegs(uint8_t reg, uint8_t* out, size_t len) = 0;
+};
+
+void attachI2c(uint8_t addr, I2cDevice* device);
+
+// LSM6DS3 model: WHO_AM_I, CTRL1_XL, OUTX, the accelerometer FIFO and the
+// wake-up interrupt, fed from a deterministic gravity-plus-motion signal
+// generator. A latched wake-up event drives `int1Pin` high until WAKE_UP_SRC
+// is read; -1 leaves INT1 unconnected.
+I2cDevice& lsm6ds3();
+void setLsm6ds3Int1Pin(int int1Pin);
+
+// ---- BLE ----
+// Scripted counterpart for single-firmware runs. When enabled, a phantom
+// central connects to any advertising peripheral after `connectLatencyMs`,
+// and `count` phantom peripherals (distinct addresses) answer scans for any
+// service and each notify `payload` every `notifyPeriodMs` once connected.
+// To a passive scan each phantom sends `payload` as a burst of three adverts
+// (20 ms apart) every `notifyPeriodMs`, under whichever company ID the scan
+// filters on; the phantoms' bursts are spread evenly over the period. The
+// four payload bytes at `seqOffset` are treated as a little-endian sequence
+// number, kept per phantom and incremented for every notification or burst.
+// With `linkDropMs` set, a phantom peripheral drops each link that long after
+// it was opened, as a tag does once its batch is delivered.
+// Each phantom is received at about `rssiDbm`, with a few dB of deterministic
+// fading on every packet. With `awayPeriodMs` set, it spends the second half
+// of every such period away, at about `awayRssiDbm` (phantoms staggered).
+static constexpr size_t kMaxBlePeers = 8;
+
+struct BlePeerOptions {
+  bool enabled;
+  size_t count;
+  uint32_t connectLatencyMs;
+  uint32_t notifyPeriodMs;
+  uint8_t payload[64];
+  size_t payloadLen;
+  size_t seqOffset;
+  uint32_t linkDropMs;
+  int8_t rssiDbm;
+  int8_t awayRssiDbm;
+  uint32_t awayPeriodMs;
+};
+
+void setBlePeer(const BlePeerOptions& options);
+
+// ---- Air ----
+// Medium between the nodes of a multi-node run, used in place of the
+// phantoms. A broadcasting node's adverts reach every node passively
+// scanning for its company ID; an advertising peripheral shows up in other
+// nodes' active scans and accepts one central link, over which its
+// notifications travel. Every packet arrives `latencyMs` after it was sent.
+// Each advert is lost with probability `lossPermille`/1000; a lost
+// notification is retried a connection interval later instead, as the link
+// layer does. With `dropMeanMs` set, links fail after an exponentially
+// distributed uptime of that mean, as if the tag moved out of range. RSSI
+// follows the phantom model (`rssiDbm`, `awayRssiDbm`, `awayPeriodMs`) per
+// sending node. Everything is drawn from a fixed-seed generator, so runs
+// repeat exactly.
+struct AirOptions {
+  uint32_t latencyMs;
+  uint16_t lossPermille;
+  uint32_t dropMeanMs;
+  int8_t rssiDbm;
+  int8_t awayRssiDbm;
+  uint32_t awayPeriodMs;
+};
+
+void setAir(const AirOptions& options);
+
+// A packet as delivered to `to`'s firmware.
+struct AirFrame {
+  size_t from;
+  size_t to;
+  uint64_t sentUs;
+  bool advert;  // else a notification
+  const uint8_t* data;
+  size_t len;
+};
+
+// Runs, as the receiving node, for every packet the air delivers.
+using AirTap = void (*)(const AirFrame& frame);
+void setAirTap(AirTap tap);
+
+// ---- Console ----
+// Serial output goes to stdout unless disabled, e.g. for long runs.
+void setConsoleEnabled(bool enabled);
+
+// ---- Run statistics ----
+struct Stats {
+  uint32_t loopIterations;
+  uint32_t deepSleeps;
+  uint64_t deepSleepUs;
+  uint32_t gpioWakes;
+  uint32_t lightSleeps;
+  uint64_t lightSleepUs;
+  uint32_t bleInits;
+  uint64_t radioOnUs;
+  uint32_t notifiesSent;
+  uint32_t notifiesReceived;
+  uint32_t broadcasts;
+  uint32_t advertsReceived;
+  uint32_t scans;
+  uint64_t scanUs;
+  uint32_t connects;
+  uint64_t connectUs;
+  uint32_t linkDrops;
+  uint32_t storageWrites;
+};
+
+Stats& stats();
+
+}  // namespace sim
+}  // namespace hal
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef HAL_SLEEP_H
+#define HAL_SLEEP_H
+
+#include <stdint.h>
+
+// HAL_RTC_DATA survives deep sleep. HAL_RTC_NOINIT is never initialized,
+// so it also survives software resets, panics and watchdog resets; its
+// contents are garbage after power-on.
+#ifdef HAL_NATIVE
+#define HAL_RTC_DATA
+#define HAL_RTC_NOINIT
+#else
+#include <esp_attr.h>
+#define HAL_RTC_DATA RTC_DATA_ATTR
+#define HAL_RTC_NOINIT RTC_NOINIT_ATTR
+#endif
+
+namespace hal {
+namespace sleep {
+
+enum class WakeCause : uint8_t {
+  kPowerOn,  // reset or first boot, not a deep-sleep wake
+  kTimer,
+  kGpio,
+  kOther,
+};
+
+// Why the chip last left deep sleep.
+WakeCause wakeCause();
+
+// Also wake the next deepUs() when `pin` reads `high`. On the ESP32-C3 only
+// GPIO0-5 can wake from deep sleep; returns false for any other pin.
+bool enableGpioWake(int pin, bool high);
+
+// Light sleep keeps RAM and peripheral state; returns after `us`.
+void lightUs(uint64_t us);
+
+// Deep sleep for `us`, or until an enableGpioWake() pin matches. On target
+// this never returns (the chip reboots into setup()). On native the virtual
+// clock is advanced and the call returns, so callers must fall through to
+// their BOOT state themselves.
+void deepUs(uint64_t us);
+
+}  // namespace sleep
+}  // namespace hal
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef HAL_STORAGE_H
+#define HAL_STORAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace hal {
+namespace storage {
+
+// Small blobs that survive reboots and power loss (NVS on the ESP32, memory
+// for the lifetime of the process on native). Keys are at most 15
+// characters. Writes wear the flash: only save what changed.
+
+// Copies the blob stored under `key` into `out` if it is exactly `len`
+// bytes; returns false if it is missing or has another size.
+bool load(const char* key, void* out, size_t len);
+bool save(const char* key, const void* data, size_t len);
+void erase(const char* key);
+
+}  // namespace storage
+}  // namespace hal
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef HAL_TIMER_H
+#define HAL_TIMER_H
+
+#include <stdint.h>
+
+#ifdef HAL_NATIVE
+#define HAL_ISR_ATTR
+#else
+#include <esp_attr.h>
+#define HAL_ISR_ATTR IRAM_ATTR
+#endif
+
+namespace hal {
+namespace timer {
+
+// Runs in interrupt context on target (from the virtual clock on native);
+// mark it HAL_ISR_ATTR and keep it short.
+using Callback = void (*)();
+
+// Claims the one-shot alarm timer and routes it to `onAlarm`.
+bool begin(Callback onAlarm);
+
+// Fires the callback once, `us` from now. Safe to call from the callback to
+// schedule the next alarm.
+void armUs(uint32_t us);
+void cancel();
+
+}  // namespace timer
+}  // namespace hal
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef HAL_NATIVE
+
+#include <BLEDevice.h>
+
+#include "hal/ble.h"
+
+namespace hal {
+namespace ble {
+
+bool init(const char* deviceName) {
+  BLEDevice::init(deviceName);
+  return true;
+}
+
+void deinit() { BLEDevice::deinit(true); }
+
+}  // namespace ble
+}  // namespace hal
+
+#endif  // HAL_NATIVE
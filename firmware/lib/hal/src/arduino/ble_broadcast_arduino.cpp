@@ -0,0 +1,47 @@
+#ifndef HAL_NATIVE
+
+#include <BLEDevice.h>
+
+#include "hal/ble.h"
+
+namespace hal {
+namespace ble {
+
+namespace {
+
+// Advertising intervals are in 0.625 ms units.
+uint16_t msToAdvUnits(uint16_t ms) { return static_cast<uint16_t>((ms * 1000UL) / 625UL); }
+
+}  // namespace
+
+bool startBroadcast(uint16_t companyId, const uint8_t* data, size_t len, uint16_t intervalMs) {
+  if (len > kMaxBroadcastLen) {
+    return false;
+  }
+
+  std::string mfg;
+  mfg.reserve(len + 2);
+  mfg.push_back(static_cast<char>(companyId & 0xFF));
+  mfg.push_back(static_cast<char>(companyId >> 8));
+  mfg.append(reinterpret_cast<const char*>(data), len);
+
+  BLEAdvertisementData adv_data;
+  adv_data.setFlags(ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT);
+  adv_data.setManufacturerData(mfg);
+
+  BLEAdvertising* adv = BLEDevice::getAdvertising();
+  adv->setAdvertisementData(adv_data);
+  adv->setScanResponse(false);
+  adv->setAdvertisementType(ADV_TYPE_NONCONN_IND);
+  adv->setMinInterval(msToAdvUnits(intervalMs));
+  adv->setMaxInterval(msToAdvUnits(intervalMs));
+  adv->start();
+  return true;
+}
+
+void stopBroadcast() { BLEDevice::getAdvertising()->stop(); }
+
+}  // namespace ble
+}  // namespace hal
+
+#endif  // HAL_NATIVE
@@ -0,0 +1,423 @@
+#ifndef HAL_NATIVE
+
+#include <BLEDevice.h>
+#include <esp_gap_ble_api.h>
+#include <esp_gattc_api.h>
+
+#include "hal/ble.h"
+
+namespace hal {
+namespace ble {
+
+namespace {
+
+// One BLEClient per link, created on first use and reused afterwards. Links
+// opened by connect() receive notifications through the library's
+// characteristic (`remote`); links opened by connectCached() have no
+// discovered attributes, so gattcEventHandler() routes theirs by handle.
+// Every notification also requests a fresh RSSI reading for the next one.
+struct Link {
+  BLEClient* client;
+  BLERemoteCharacteristic* remote;
+  Address peer;
+  volatile bool up;
+  NotifyHandler on_notify;
+  uint16_t conn_id;
+  uint16_t value_handle;
+  volatile int cccd_status;  // -1 while the CCCD write is in flight
+  volatile int8_t rssi;      // newest reading, kRssiUnknown before the first
+};
+
+Link g_links[kMaxLinks] = {};
+LinkDownHandler g_on_link_down = nullptr;
+
+class ClientCallbacks : public BLEClientCallbacks {
+ public:
+  void onConnect(BLEClient* /*client*/) override {}
+  // dropLink() clears `up` first, so only unexpected drops are reported.
+  void onDisconnect(BLEClient* client) override {
+    for (Link& link : g_links) {
+      if (link.client == client && link.up) {
+        link.up = false;
+        if (g_on_link_down != nullptr) {
+          g_on_link_down(link.peer);
+        }
+      }
+    }
+  }
+};
+
+ClientCallbacks g_client_callbacks;
+
+// Slot holding a live link to `peer`, or kMaxLinks.
+size_t findLink(const Address& peer) {
+  for (size_t i = 0; i < kMaxLinks; ++i) {
+    if (g_links[i].up && sameAddress(g_links[i].peer, peer)) {
+      return i;
+    }
+  }
+  return kMaxLinks;
+}
+
+class AdvertCallbacks : public BLEAdvertisedDeviceCallbacks {
+ public:
+  void onResult(BLEAdvertisedDevice device) override {
+    if (on_advert_ == nullptr || !device.haveManufacturerData()) {
+      return;
+    }
+    const std::string mfg = device.getManufacturerData();
+    if (mfg.size() < 2) {
+      return;
+    }
+    const uint16_t company = static_cast<uint16_t>(static_cast<uint8_t>(mfg[0]) |
+                                                   (static_cast<uint8_t>(mfg[1]) << 8));
+    if (company != company_id_) {
+      return;
+    }
+
+    Address from;
+    memcpy(from.bytes, device.getAddress().getNative(), sizeof(from.bytes));
+    from.type = static_cast<uint8_t>(device.getAddressType());
+    on_advert_(from, static_cast<int8_t>(device.getRSSI()),
+               reinterpret_cast<const uint8_t*>(mfg.data()) + 2, mfg.size() - 2);
+  }
+
+  void configure(uint16_t companyId, AdvertHandler onAdvert) {
+    company_id_ = companyId;
+    on_advert_ = onAdvert;
+  }
+
+ private:
+  uint16_t company_id_ = 0;
+  AdvertHandler on_advert_ = nullptr;
+};
+
+AdvertCallbacks g_advert_callbacks;
+volatile bool g_scanning = false;
+
+// BLEScan keeps every distinct advertiser it hears until the next start(),
+// and phones rotate random addresses, so the passive scan runs in windows
+// of kPassiveScanWindowS. Each window's end restarts the scan from the BLE
+// task, which clears the results without racing the handler that fills
+// them.
+constexpr uint32_t kPassiveScanWindowS = 60;
+
+void onPassiveScanWindowEnd(BLEScanResults /*results*/) {
+  if (g_scanning) {
+    BLEDevice::getScan()->start(kPassiveScanWindowS, onPassiveScanWindowEnd, false);
+  }
+}
+
+// Collects advertisers of one service during an active scan and ends the
+// scan once enough have been seen.
+class ScanCollector : public BLEAdvertisedDeviceCallbacks {
+ public:
+  void onResult(BLEAdvertisedDevice device) override {
+    if (found_ >= max_ || !device.haveServiceUUID() || !device.isAdvertisingService(uuid_)) {
+      return;
+    }
+    Address& out = out_[found_];
+    memcpy(out.bytes, device.getAddress().getNative(), sizeof(out.bytes));
+    out.type = static_cast<uint8_t>(device.getAddressType());
+    for (size_t i = 0; i < found_; ++i) {
+      if (sameAddress(out_[i], out)) {
+        return;
+      }
+    }
+    if (++found_ >= max_) {
+      BLEDevice::getScan()->stop();
+    }
+  }
+
+  void configure(const char* serviceUuid, Address* out, size_t maxOut) {
+    uuid_ = BLEUUID(serviceUuid);
+    out_ = out;
+    max_ = maxOut;
+    found_ = 0;
+  }
+
+  size_t found() const { return found_; }
+  bool done() const { return found_ >= max_; }
+
+ private:
+  BLEUUID uuid_ = BLEUUID(static_cast<uint16_t>(0));
+  Address* out_ = nullptr;
+  size_t max_ = 0;
+  volatile size_t found_ = 0;
+};
+
+ScanCollector g_scan_collector;
+bool g_handlers_installed = false;
+
+// Queues an RSSI read for `link`; the controller answers through
+// gapEventHandler() a connection event or two later. Never blocks, so it is
+// safe from the notification path.
+void requestRssi(Link& link) {
+  esp_ble_gap_read_rssi(link.peer.bytes);
+}
+
+void deliver(Link& link, const uint8_t* data, size_t len) {
+  link.on_notify(link.peer, link.rssi, data, len);
+  requestRssi(link);
+}
+
+// Shared by every link; the characteristic identifies the sender.
+void notifyTrampoline(BLERemoteCharacteristic* remote, uint8_t* data, size_t len, bool /*isNotify*/) {
+  for (Link& link : g_links) {
+    if (link.up && link.remote == remote && link.on_notify != nullptr) {
+      deliver(link, data, len);
+      return;
+    }
+  }
+}
+
+void gapEventHandler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param) {
+  if (event != ESP_GAP_BLE_READ_RSSI_COMPLETE_EVT || param->read_rssi_cmpl.status != ESP_BT_STATUS_SUCCESS) {
+    return;
+  }
+  for (Link& link : g_links) {
+    if (link.up && memcmp(link.peer.bytes, param->read_rssi_cmpl.remote_addr, sizeof(link.peer.bytes)) == 0) {
+      link.rssi = param->read_rssi_cmpl.rssi;
+      return;
+    }
+  }
+}
+
+// Notifications and CCCD write results for links opened by connectCached().
+void gattcEventHandler(esp_gattc_cb_event_t event, esp_gatt_if_t /*gattc_if*/,
+                       esp_ble_gattc_cb_param_t* param) {
+  for (Link& link : g_links) {
+    if (!link.up || link.remote != nullptr) {
+      continue;
+    }
+    if (event == ESP_GATTC_NOTIFY_EVT && param->notify.conn_id == link.conn_id &&
+        param->notify.handle == link.value_handle && link.on_notify != nullptr) {
+      deliver(link, param->notify.value, param->notify.value_len);
+      return;
+    }
+    if (event == ESP_GATTC_WRITE_DESCR_EVT && param->write.conn_id == link.conn_id) {
+      link.cccd_status = param->write.status;
+      return;
+    }
+  }
+}
+
+void dropLink(Link& link) {
+  link.up = false;
+  link.remote = nullptr;
+  link.client->disconnect();
+}
+
+// Slot for a new link to `peer` (replacing an existing one), with its client
+// created; kMaxLinks if all are taken.
+size_t acquireLink(const Address& peer) {
+  size_t slot = findLink(peer);
+  if (slot != kMaxLinks) {
+    dropLink(g_links[slot]);
+  } else {
+    slot = 0;
+    while (slot < kMaxLinks && g_links[slot].up) {
+      ++slot;
+    }
+    if (slot == kMaxLinks) {
+      return kMaxLinks;
+    }
+  }
+  Link& link = g_links[slot];
+  if (link.client == nullptr) {
+    link.client = BLEDevice::createClient();
+    link.client->setClientCallbacks(&g_client_callbacks);
+  }
+  return slot;
+}
+
+void installHandlers() {
+  if (!g_handlers_installed) {
+    BLEDevice::setCustomGattcHandler(gattcEventHandler);
+    BLEDevice::setCustomGapHandler(gapEventHandler);
+    g_handlers_installed = true;
+  }
+}
+
+// CCCD writes are answered within a few connection intervals.
+constexpr uint32_t kCccdWriteTimeoutMs = 1000;
+
+}  // namespace
+
+size_t scanForService(const char* serviceUuid, uint32_t seconds, Address* out, size_t maxOut) {
+  if (maxOut == 0) {
+    return 0;
+  }
+  g_scan_collector.configure(serviceUuid, out, maxOut);
+  BLEScan* scan = BLEDevice::getScan();
+  scan->setAdvertisedDeviceCallbacks(&g_scan_collector, true);
+  scan->setActiveScan(true);
+  // Non-blocking start; the collector stops the scan once it has enough.
+  const uint32_t start_ms = millis();
+  if (!scan->start(seconds, nullptr, false)) {
+    return 0;
+  }
+  while (!g_scan_collector.done() && millis() - start_ms < seconds * 1000UL) {
+    delay(10);
+  }
+  scan->stop();
+  scan->clearResults();
+  return g_scan_collector.found();
+}
+
+ConnectResult connect(const Address& peer, const char* serviceUuid, const char* charUuid,
+                      NotifyHandler onNotify, GattHandles* resolved) {
+  installHandlers();
+  const size_t slot = acquireLink(peer);
+  if (slot == kMaxLinks) {
+    return ConnectResult::kNoFreeLink;
+  }
+  Link& link = g_links[slot];
+
+  uint8_t native[6];
+  memcpy(native, peer.bytes, sizeof(native));
+  if (!link.client->connect(BLEAddress(native), peer.type)) {
+    return ConnectResult::kConnectFailed;
+  }
+
+  // getService() blocks until discovery completes; no fixed delay needed.
+  BLERemoteService* service = link.client->getService(BLEUUID(serviceUuid));
+  if (service == nullptr) {
+    link.client->disconnect();
+    return ConnectResult::kServiceMissing;
+  }
+
+  BLERemoteCharacteristic* remote = service->getCharacteristic(BLEUUID(charUuid));
+  if (remote == nullptr) {
+    link.client->disconnect();
+    return ConnectResult::kCharacteristicMissing;
+  }
+
+  if (!remote->canNotify()) {
+    link.client->disconnect();
+    return ConnectResult::kNotifyUnsupported;
+  }
+
+  BLERemoteDescriptor* cccd = remote->getDescriptor(BLEUUID(static_cast<uint16_t>(0x2902)));
+  if (cccd == nullptr) {
+    link.client->disconnect();
+    return ConnectResult::kCccdMissing;
+  }
+
+  // Publish the link before subscribing so the first notification finds it.
+  link.peer = peer;
+  link.remote = remote;
+  link.on_notify = onNotify;
+  link.rssi = kRssiUnknown;
+  link.up = true;
+  if (!remote->registerForNotify(notifyTrampoline)) {
+    dropLink(link);
+    return ConnectResult::kSubscribeFailed;
+  }
+  if (resolved != nullptr) {
+    resolved->value = remote->getHandle();
+    resolved->cccd = cccd->getHandle();
+  }
+  requestRssi(link);
+  return ConnectResult::kOk;
+}
+
+ConnectResult connectCached(const Address& peer, const GattHandles& handles, NotifyHandler onNotify) {
+  installHandlers();
+  const size_t slot = acquireLink(peer);
+  if (slot == kMaxLinks) {
+    return ConnectResult::kNoFreeLink;
+  }
+  Link& link = g_links[slot];
+
+  uint8_t native[6];
+  memcpy(native, peer.bytes, sizeof(native));
+  if (!link.client->connect(BLEAddress(native), peer.type)) {
+    return ConnectResult::kConnectFailed;
+  }
+
+  link.peer = peer;
+  link.remote = nullptr;
+  link.on_notify = onNotify;
+  link.conn_id = link.client->getConnId();
+  link.value_handle = handles.value;
+  link.cccd_status = -1;
+  link.rssi = kRssiUnknown;
+  link.up = true;
+
+  const esp_gatt_if_t gattc_if = link.client->getGattcIf();
+  uint8_t enable[2] = {0x01, 0x00};
+  if (esp_ble_gattc_register_for_notify(gattc_if, native, handles.value) != ESP_OK ||
+      esp_ble_gattc_write_char_descr(gattc_if, link.conn_id, handles.cccd, sizeof(enable), enable,
+                                     ESP_GATT_WRITE_TYPE_RSP, ESP_GATT_AUTH_REQ_NONE) != ESP_OK) {
+    dropLink(link);
+    return ConnectResult::kSubscribeFailed;
+  }
+  const uint32_t start_ms = millis();
+  while (link.cccd_status < 0 && millis() - start_ms < kCccdWriteTimeoutMs) {
+    delay(5);
+  }
+  if (link.cccd_status != ESP_GATT_OK) {
+    dropLink(link);
+    return ConnectResult::kSubscribeFailed;
+  }
+  requestRssi(link);
+  return ConnectResult::kOk;
+}
+
+bool centralConnected(const Address& peer) {
+  const size_t slot = findLink(peer);
+  return slot != kMaxLinks && g_links[slot].client->isConnected();
+}
+
+void setLinkDownHandler(LinkDownHandler onLinkDown) { g_on_link_down = onLinkDown; }
+
+size_t centralLinks() {
+  size_t up = 0;
+  for (const Link& link : g_links) {
+    up += (link.up && link.client->isConnected()) ? 1 : 0;
+  }
+  return up;
+}
+
+void disconnect(const Address& peer) {
+  const size_t slot = findLink(peer);
+  if (slot != kMaxLinks) {
+    dropLink(g_links[slot]);
+  }
+}
+
+void disconnectAll() {
+  for (Link& link : g_links) {
+    if (link.up) {
+      dropLink(link);
+    }
+  }
+}
+
+bool startPassiveScan(uint16_t companyId, uint16_t intervalMs, AdvertHandler onAdvert) {
+  g_advert_callbacks.configure(companyId, onAdvert);
+
+  // Scan interval/window are in 0.625 ms units.
+  const uint16_t units = static_cast<uint16_t>((intervalMs * 1000UL) / 625UL);
+  BLEScan* scan = BLEDevice::getScan();
+  scan->setAdvertisedDeviceCallbacks(&g_advert_callbacks, true);
+  scan->setActiveScan(false);
+  scan->setInterval(units);
+  scan->setWindow(units);
+  g_scanning = scan->start(kPassiveScanWindowS, onPassiveScanWindowEnd, false);
+  return g_scanning;
+}
+
+bool scanning() { return g_scanning; }
+
+void stopScan() {
+  g_scanning = false;  // first, so a window ending now does not restart
+  BLEDevice::getScan()->stop();
+  BLEDevice::getScan()->clearResults();
+}
+
+}  // namespace ble
+}  // namespace hal
+
+#endif  // HAL_NATIVE
@@ -0,0 +1,65 @@
+#ifndef HAL_NATIVE
+
+#include <BLEDevice.h>
+
+#include "hal/ble.h"
+
+namespace hal {
+namespace ble {
+
+namespace {
+
+class ServerCallbacks : public BLEServerCallbacks {
+ public:
+  void onConnect(BLEServer* /*server*/) override { connected_ = true; }
+  void onDisconnect(BLEServer* server) override {
+    connected_ = false;
+    server->startAdvertising();
+  }
+
+  bool isConnected() const { return connected_; }
+
+ private:
+  volatile bool connected_ = false;
+};
+
+ServerCallbacks g_server_callbacks;
+BLECharacteristic* g_char = nullptr;
+
+}  // namespace
+
+bool startPeripheral(const char* serviceUuid, const char* charUuid) {
+  BLEServer* server = BLEDevice::createServer();
+  server->setCallbacks(&g_server_callbacks);
+
+  BLEService* service = server->createService(BLEUUID(serviceUuid));
+  g_char = service->createCharacteristic(
+      BLEUUID(charUuid), BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY);
+  service->start();
+
+  BLEAdvertising* adv = BLEDevice::getAdvertising();
+  adv->addServiceUUID(BLEUUID(serviceUuid));
+  adv->start();
+  return g_char != nullptr;
+}
+
+bool peripheralConnected() { return g_server_callbacks.isConnected(); }
+
+bool notify(const uint8_t* data, size_t len) {
+  if (g_char == nullptr) {
+    return false;
+  }
+  g_char->setValue(const_cast<uint8_t*>(data), len);
+  g_char->notify();
+  return true;
+}
+
+void stopPeripheral() {
+  BLEDevice::getAdvertising()->stop();
+  g_char = nullptr;
+}
+
+}  // namespace ble
+}  // namespace hal
+
+#endif  // HAL_NATIVE
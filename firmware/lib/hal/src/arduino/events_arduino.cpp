@@ -0,0 +1,90 @@
+#ifndef HAL_NATIVE
+
+#include <Arduino.h>
+#include <esp_pm.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+#include "hal/events.h"
+
+namespace hal {
+namespace events {
+
+namespace {
+
+QueueHandle_t g_queue = nullptr;
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+// Held through holdAwake() while automatic light sleep must wait.
+esp_pm_lock_handle_t g_awake_lock = nullptr;
+#endif
+
+// The C3's fastest clock, and the XTAL frequency it drops to when idle.
+constexpr int kMaxCpuMhz = 160;
+constexpr int kMinCpuMhz = 40;
+
+}  // namespace
+
+bool begin() {
+  if (g_queue == nullptr) {
+    g_queue = xQueueCreate(kQueueDepth, sizeof(uint8_t));
+  }
+  return g_queue != nullptr;
+}
+
+bool post(uint8_t event) { return g_queue != nullptr && xQueueSend(g_queue, &event, 0) == pdTRUE; }
+
+bool IRAM_ATTR postFromIsr(uint8_t event) {
+  if (g_queue == nullptr) {
+    return false;
+  }
+  BaseType_t woken = pdFALSE;
+  const bool queued = xQueueSendFromISR(g_queue, &event, &woken) == pdTRUE;
+  if (woken == pdTRUE) {
+    portYIELD_FROM_ISR();
+  }
+  return queued;
+}
+
+bool wait(uint8_t* event, uint32_t timeoutMs) {
+  if (g_queue == nullptr) {
+    ::delay(timeoutMs);
+    return false;
+  }
+  return xQueueReceive(g_queue, event, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+}
+
+bool enableAutoLightSleep() {
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+  esp_pm_config_esp32c3_t config = {};
+  config.max_freq_mhz = kMaxCpuMhz;
+  config.min_freq_mhz = kMinCpuMhz;
+  config.light_sleep_enable = true;
+  if (g_awake_lock == nullptr &&
+      esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "hal_awake", &g_awake_lock) != ESP_OK) {
+    return false;
+  }
+  return esp_pm_configure(&config) == ESP_OK;
+#else
+  // The stock Arduino core is built without tickless idle.
+  return false;
+#endif
+}
+
+void IRAM_ATTR holdAwake(bool hold) {
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+  if (g_awake_lock != nullptr) {
+    if (hold) {
+      esp_pm_lock_acquire(g_awake_lock);
+    } else {
+      esp_pm_lock_release(g_awake_lock);
+    }
+  }
+#else
+  (void)hold;
+#endif
+}
+
+}  // namespace events
+}  // namespace hal
+
+#endif  // HAL_NATIVE
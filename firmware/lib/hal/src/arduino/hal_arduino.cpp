@@ -0,0 +1,225 @@
+#ifndef HAL_NATIVE
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <driver/gpio.h>
+#include <esp_sleep.h>
+#include <hal/ledc_ll.h>
+#include <soc/gpio_reg.h>
+#include <soc/soc.h>
+#include <sys/time.h>
+
+#include "hal/clock.h"
+#include "hal/critical.h"
+#include "hal/gpio.h"
+#include "hal/i2c.h"
+#include "hal/pwm.h"
+#include "hal/sleep.h"
+#include "hal/timer.h"
+
+namespace hal {
+
+namespace {
+
+portMUX_TYPE g_critical_mux = portMUX_INITIALIZER_UNLOCKED;
+
+hw_timer_t* g_alarm_timer = nullptr;
+timer::Callback g_alarm_callback = nullptr;
+
+void IRAM_ATTR onAlarmTimer() {
+  if (g_alarm_callback != nullptr) {
+    g_alarm_callback();
+  }
+}
+
+}  // namespace
+
+void enterCritical() { portENTER_CRITICAL(&g_critical_mux); }
+void exitCritical() { portEXIT_CRITICAL(&g_critical_mux); }
+
+namespace clock {
+
+uint32_t millis() { return ::millis(); }
+uint32_t micros() { return ::micros(); }
+void delayMs(uint32_t ms) { ::delay(ms); }
+void delayUs(uint32_t us) { ::delayMicroseconds(us); }
+
+uint32_t rtcSeconds() {
+  // ESP-IDF keeps system time on the RTC timer across deep sleep.
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return static_cast<uint32_t>(tv.tv_sec);
+}
+
+}  // namespace clock
+
+namespace gpio {
+
+void configure(int pin, Mode mode) {
+  switch (mode) {
+    case Mode::kInput:
+      ::pinMode(pin, INPUT);
+      break;
+    case Mode::kInputPullup:
+      ::pinMode(pin, INPUT_PULLUP);
+      break;
+    case Mode::kOutput:
+      ::pinMode(pin, OUTPUT);
+      break;
+  }
+}
+
+void write(int pin, bool high) { ::digitalWrite(pin, high ? HIGH : LOW); }
+bool read(int pin) { return ::digitalRead(pin) == HIGH; }
+int analogRead(int pin) { return ::analogRead(pin); }
+// The core characterises the ADC from eFuse once and applies it per read.
+int analogReadMv(int pin) { return static_cast<int>(::analogReadMilliVolts(pin)); }
+
+void IRAM_ATTR writeMasked(uint32_t mask, uint32_t levels) {
+  REG_WRITE(GPIO_OUT_REG, (REG_READ(GPIO_OUT_REG) & ~mask) | (levels & mask));
+}
+
+bool attachInterrupt(int pin, Edge edge, IsrCallback onEdge) {
+  if (pin < 0) {
+    return false;
+  }
+  const bool falling = edge == Edge::kFalling;
+  ::attachInterrupt(digitalPinToInterrupt(pin), onEdge, falling ? FALLING : RISING);
+  // Edge interrupts need the GPIO clock, which light sleep gates; a level
+  // wake restarts it in time for the edge to be seen.
+  const gpio_int_type_t wake_level = falling ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL;
+  return gpio_wakeup_enable(static_cast<gpio_num_t>(pin), wake_level) == ESP_OK &&
+         esp_sleep_enable_gpio_wakeup() == ESP_OK;
+}
+
+}  // namespace gpio
+
+namespace i2c {
+
+bool begin(int sda, int scl, uint32_t hz) {
+  if (!Wire.begin(sda, scl)) {
+    return false;
+  }
+  Wire.setClock(hz);
+  return true;
+}
+
+bool writeReg(uint8_t addr, uint8_t reg, uint8_t val) {
+  Wire.beginTransmission(addr);
+  Wire.write(reg);
+  Wire.write(val);
+  return Wire.endTransmission() == 0;
+}
+
+bool readRegs(uint8_t addr, uint8_t reg, uint8_t* out, size_t len) {
+  if (len > kMaxReadLen) {
+    return false;
+  }
+  Wire.beginTransmission(addr);
+  Wire.write(reg);
+  if (Wire.endTransmission(false) != 0) {
+    return false;
+  }
+  const size_t got = Wire.requestFrom(static_cast<int>(addr), static_cast<int>(len));
+  if (got != len) {
+    return false;
+  }
+  for (size_t i = 0; i < len; ++i) {
+    out[i] = Wire.read();
+  }
+  return true;
+}
+
+}  // namespace i2c
+
+namespace pwm {
+
+bool attach(uint8_t channel, int pin, uint32_t hz, uint8_t bits) {
+  if (channel >= kMaxChannels || pin < 0 || ledcSetup(channel, hz, bits) == 0) {
+    return false;
+  }
+  ledcAttachPin(pin, channel);
+  // Also sets up the channel's duty fade registers the way write() needs.
+  ledcWrite(channel, 0);
+  return true;
+}
+
+// ledcWrite() takes a driver lock and lives in flash; the low-level calls
+// are inline register writes.
+void IRAM_ATTR write(uint8_t channel, uint32_t duty) {
+  const ledc_channel_t ch = static_cast<ledc_channel_t>(channel);
+  ledc_ll_set_duty_int_part(&LEDC, LEDC_LOW_SPEED_MODE, ch, duty);
+  ledc_ll_set_duty_start(&LEDC, LEDC_LOW_SPEED_MODE, ch, true);
+  ledc_ll_ls_channel_update(&LEDC, LEDC_LOW_SPEED_MODE, ch);
+}
+
+}  // namespace pwm
+
+namespace timer {
+
+bool begin(Callback onAlarm) {
+  if (g_alarm_timer == nullptr) {
+    // Timer group 0 at 80 MHz APB / 80 = 1 tick per microsecond.
+    g_alarm_timer = timerBegin(0, 80, true);
+    if (g_alarm_timer == nullptr) {
+      return false;
+    }
+    timerAttachInterrupt(g_alarm_timer, &onAlarmTimer, true);
+  }
+  g_alarm_callback = onAlarm;
+  return true;
+}
+
+void IRAM_ATTR armUs(uint32_t us) {
+  timerWrite(g_alarm_timer, 0);
+  timerAlarmWrite(g_alarm_timer, us, false);
+  timerAlarmEnable(g_alarm_timer);
+}
+
+void cancel() {
+  if (g_alarm_timer != nullptr) {
+    timerAlarmDisable(g_alarm_timer);
+  }
+}
+
+}  // namespace timer
+
+namespace sleep {
+
+WakeCause wakeCause() {
+  switch (esp_sleep_get_wakeup_cause()) {
+    case ESP_SLEEP_WAKEUP_UNDEFINED:
+      return WakeCause::kPowerOn;
+    case ESP_SLEEP_WAKEUP_TIMER:
+      return WakeCause::kTimer;
+    case ESP_SLEEP_WAKEUP_GPIO:
+      return WakeCause::kGpio;
+    default:
+      return WakeCause::kOther;
+  }
+}
+
+bool enableGpioWake(int pin, bool high) {
+  if (pin < 0 || !esp_sleep_is_valid_wakeup_gpio(static_cast<gpio_num_t>(pin))) {
+    return false;
+  }
+  const esp_deepsleep_gpio_wake_up_mode_t mode =
+      high ? ESP_GPIO_WAKEUP_GPIO_HIGH : ESP_GPIO_WAKEUP_GPIO_LOW;
+  return esp_deep_sleep_enable_gpio_wakeup(1ULL << pin, mode) == ESP_OK;
+}
+
+void lightUs(uint64_t us) {
+  esp_sleep_enable_timer_wakeup(us);
+  esp_light_sleep_start();
+}
+
+void deepUs(uint64_t us) {
+  esp_sleep_enable_timer_wakeup(us);
+  esp_deep_sleep_start();
+}
+
+}  // namespace sleep
+
+}  // namespace hal
+
+#endif  // HAL_NATIVE
@@ -0,0 +1,47 @@
+#ifndef HAL_NATIVE
+
+#include <Preferences.h>
+
+#include "hal/storage.h"
+
+namespace hal {
+namespace storage {
+
+namespace {
+
+constexpr const char* kNamespace = "hal";
+
+}  // namespace
+
+bool load(const char* key, void* out, size_t len) {
+  Preferences prefs;
+  if (!prefs.begin(kNamespace, true)) {
+    return false;
+  }
+  const bool ok = prefs.getBytesLength(key) == len && prefs.getBytes(key, out, len) == len;
+  prefs.end();
+  return ok;
+}
+
+bool save(const char* key, const void* data, size_t len) {
+  Preferences prefs;
+  if (!prefs.begin(kNamespace, false)) {
+    return false;
+  }
+  const bool ok = prefs.putBytes(key, data, len) == len;
+  prefs.end();
+  return ok;
+}
+
+void erase(const char* key) {
+  Preferences prefs;
+  if (prefs.begin(kNamespace, false)) {
+    prefs.remove(key);
+    prefs.end();
+  }
+}
+
+}  // namespace storage
+}  // namespace hal
+
+#endif  // HAL_NATIVE
@@ -0,0 +1,737 @@
+#ifdef HAL_NATIVE
+
+#include <math.h>
+#include <string.h>
+
+#include "hal/ble.h"
+#include "hal/console.h"
+#include "hal/sim.h"
+
+namespace hal {
+
+namespace {
+
+sim::BlePeerOptions g_peer = {};
+// Per-phantom copy of the payload, so each keeps its own sequence number.
+uint8_t g_peer_payload[sim::kMaxBlePeers][sizeof(g_peer.payload)];
+
+sim::AirOptions g_air = {};
+bool g_air_enabled = false;
+sim::AirTap g_air_tap = nullptr;
+uint32_t g_air_rng = 1;
+
+// A central link. `peer` is the phantom or, over the air, the node.
+struct Link {
+  bool up;
+  size_t peer;
+  ble::Address address;
+  ble::NotifyHandler on_notify;
+  uint32_t generation;
+  int8_t rssi;  // as on hardware, the reading taken after the last notification
+};
+
+// One node's radio.
+struct Radio {
+  bool initialized;
+  uint64_t init_us;
+
+  // Peripheral role. Over the air `linked` means a central holds the link in
+  // its slot `central_slot`; notifications never arrive before `rx_free_us`,
+  // so retries keep them in order.
+  bool advertising;
+  uint64_t adv_start_us;
+  bool linked;
+  size_t central;
+  size_t central_slot;
+  uint64_t rx_free_us;
+
+  Link links[ble::kMaxLinks];
+  ble::LinkDownHandler on_link_down;
+
+  bool broadcasting;
+  uint16_t company_id;
+  uint16_t adv_interval_ms;
+  uint8_t adv_data[ble::kMaxBroadcastLen];
+  size_t adv_len;
+  uint32_t broadcast_generation;
+
+  bool scanning;
+  uint16_t scan_company_id;
+  ble::AdvertHandler on_advert;
+  uint32_t scan_generation;
+};
+
+Radio g_radios[sim::kMaxNodes] = {};
+
+Radio& radio() { return g_radios[sim::currentNode()]; }
+
+// Adverts per phantom burst and their spacing.
+constexpr int kPeerBurstAdverts = 3;
+constexpr uint64_t kPeerBurstSpacingUs = 20000;
+// Peak-to-peak fading added to every received packet.
+constexpr int kPeerRssiFadeDb = 8;
+uint32_t g_fade_state = 1;
+
+// Active-scan and GATT timings of a phantom peripheral: it is seen within
+// one advertising interval, discovery costs a few round trips and enabling
+// notifications by handle costs one.
+constexpr uint64_t kPeerAdvIntervalUs = 100000;
+constexpr uint64_t kPeerDiscoveryUs = 300000;
+constexpr uint64_t kPeerCccdWriteUs = 30000;
+constexpr ble::GattHandles kPeerHandles = {0x002A, 0x002B};
+
+// Over the air: a lost notification is retried a connection interval later,
+// at most kAirMaxRetries times.
+constexpr uint64_t kAirConnIntervalUs = 30000;
+constexpr int kAirMaxRetries = 6;
+
+ble::Address peerAddress(size_t peer) {
+  ble::Address address = {{0xC0, 0xFF, 0xEE, 0x00, 0x05, 0x14}, 0};
+  address.bytes[5] = static_cast<uint8_t>(address.bytes[5] + peer);
+  return address;
+}
+
+ble::Address nodeAddress(size_t node) {
+  ble::Address address = {{0xC0, 0xFF, 0xEE, 0x00, 0x0A, 0x00}, 0};
+  address.bytes[5] = static_cast<uint8_t>(node);
+  return address;
+}
+
+// Index of the phantom at `address`, or g_peer.count if there is none.
+size_t findPeer(const ble::Address& address) {
+  size_t peer = 0;
+  while (peer < g_peer.count && !ble::sameAddress(peerAddress(peer), address)) {
+    ++peer;
+  }
+  return peer;
+}
+
+// Node at `address`, or sim::kMaxNodes if there is none.
+size_t findNode(const ble::Address& address) {
+  size_t node = 0;
+  while (node < sim::nodeCount() && !ble::sameAddress(nodeAddress(node), address)) {
+    ++node;
+  }
+  return node < sim::nodeCount() ? node : sim::kMaxNodes;
+}
+
+// Link slot up to `address`, or kMaxLinks if there is none.
+size_t findLink(const ble::Address& address) {
+  const Radio& r = radio();
+  size_t slot = 0;
+  while (slot < ble::kMaxLinks && !(r.links[slot].up && ble::sameAddress(r.links[slot].address, address))) {
+    ++slot;
+  }
+  return slot;
+}
+
+// Free link slot, or kMaxLinks if every slot is taken.
+size_t freeLink() {
+  const Radio& r = radio();
+  size_t slot = 0;
+  while (slot < ble::kMaxLinks && r.links[slot].up) {
+    ++slot;
+  }
+  return slot;
+}
+
+// RSSI right now of a sender with index `index` of `count`: near, or away
+// for the second half of every `awayPeriodMs` (senders staggered), plus
+// fading.
+int8_t modelRssi(int8_t nearDbm, int8_t awayDbm, uint32_t awayPeriodMs, size_t index, size_t count) {
+  int rssi = nearDbm;
+  if (awayPeriodMs != 0) {
+    const uint64_t period_us = awayPeriodMs * 1000ULL;
+    const uint64_t phase_us = (sim::nowUs() + index * period_us / count) % period_us;
+    rssi = phase_us >= period_us / 2 ? awayDbm : nearDbm;
+  }
+  g_fade_state = g_fade_state * 1103515245u + 12345u;
+  rssi += static_cast<int>((g_fade_state >> 16) % (kPeerRssiFadeDb + 1)) - kPeerRssiFadeDb / 2;
+  return static_cast<int8_t>(rssi);
+}
+
+int8_t peerRssi(size_t peer) {
+  return modelRssi(g_peer.rssiDbm, g_peer.awayRssiDbm, g_peer.awayPeriodMs, peer, g_peer.count);
+}
+
+int8_t airRssi(size_t from) {
+  return modelRssi(g_air.rssiDbm, g_air.awayRssiDbm, g_air.awayPeriodMs, from, sim::nodeCount());
+}
+
+void printHex(const uint8_t* data, size_t len) {
+  static const char kDigits[] = "0123456789abcdef";
+  for (size_t i = 0; i < len; ++i) {
+    Serial.print(kDigits[data[i] >> 4]);
+    Serial.print(kDigits[data[i] & 0x0F]);
+  }
+}
+
+void bumpPeerSeq(size_t peer) {
+  if (g_peer.payloadLen >= g_peer.seqOffset + 4) {
+    uint8_t* at = g_peer_payload[peer] + g_peer.seqOffset;
+    uint32_t seq = 0;
+    memcpy(&seq, at, sizeof(seq));
+    ++seq;
+    memcpy(at, &seq, sizeof(seq));
+  }
+}
+
+// Start of phantom `peer`'s first burst or notification after `now_us`.
+uint64_t peerPhaseUs(size_t peer, uint64_t now_us) {
+  const uint64_t period_us = g_peer.notifyPeriodMs * 1000ULL;
+  return now_us + period_us + peer * period_us / g_peer.count;
+}
+
+// ctx packs the link generation (high bits) and the slot (low byte).
+void peerNotify(void* ctx) {
+  const uintptr_t packed = reinterpret_cast<uintptr_t>(ctx);
+  const uint32_t generation = static_cast<uint32_t>(packed >> 8);
+  Link& link = radio().links[packed & 0xFF];
+  if (!link.up || generation != link.generation || link.on_notify == nullptr) {
+    return;
+  }
+
+  uint8_t payload[sizeof(g_peer.payload)];
+  memcpy(payload, g_peer_payload[link.peer], g_peer.payloadLen);
+  link.on_notify(peerAddress(link.peer), link.rssi, payload, g_peer.payloadLen);
+  link.rssi = peerRssi(link.peer);
+  ++sim::stats().notifiesReceived;
+  bumpPeerSeq(link.peer);
+  sim::schedule(sim::nowUs() + g_peer.notifyPeriodMs * 1000ULL, peerNotify, ctx);
+}
+
+// Same ctx packing as peerNotify().
+void peerDropLink(void* ctx) {
+  const uintptr_t packed = reinterpret_cast<uintptr_t>(ctx);
+  Radio& r = radio();
+  Link& link = r.links[packed & 0xFF];
+  if (link.up && static_cast<uint32_t>(packed >> 8) == link.generation) {
+    link.up = false;
+    ++link.generation;
+    ++sim::stats().linkDrops;
+    if (r.on_link_down != nullptr) {
+      r.on_link_down(link.address);
+    }
+  }
+}
+
+// ctx packs the scan generation (high bits), the phantom (second byte) and
+// the advert index in its current burst (low byte).
+void peerAdvert(void* ctx) {
+  const uintptr_t packed = reinterpret_cast<uintptr_t>(ctx);
+  const uint32_t generation = static_cast<uint32_t>(packed >> 16);
+  const size_t peer = (packed >> 8) & 0xFF;
+  const int index = static_cast<int>(packed & 0xFF);
+  const Radio& r = radio();
+  if (!r.scanning || generation != r.scan_generation || r.on_advert == nullptr) {
+    return;
+  }
+
+  uint8_t payload[sizeof(g_peer.payload)];
+  memcpy(payload, g_peer_payload[peer], g_peer.payloadLen);
+  r.on_advert(peerAddress(peer), peerRssi(peer), payload, g_peer.payloadLen);
+  ++sim::stats().advertsReceived;
+
+  const uintptr_t base = (static_cast<uintptr_t>(generation) << 16) | (peer << 8);
+  uint64_t next_us = sim::nowUs() + kPeerBurstSpacingUs;
+  uintptr_t next = base | static_cast<uintptr_t>(index + 1);
+  if (index + 1 >= kPeerBurstAdverts) {
+    bumpPeerSeq(peer);
+    const uint64_t burst_start_us = sim::nowUs() - index * kPeerBurstSpacingUs;
+    next_us = burst_start_us + g_peer.notifyPeriodMs * 1000ULL;
+    next = base;
+  }
+  sim::schedule(next_us, peerAdvert, reinterpret_cast<void*>(next));
+}
+
+// ---- Air ----
+
+uint32_t airRandom() {
+  g_air_rng = g_air_rng * 1103515245u + 12345u;
+  return g_air_rng >> 8;
+}
+
+bool airLost() { return g_air.lossPermille != 0 && airRandom() % 1000 < g_air.lossPermille; }
+
+// A packet in flight to `to`; `generation` is the receiver's scan or link
+// generation when it was sent, so nothing arrives on a later scan or link.
+struct AirPacket {
+  size_t from;
+  size_t to;
+  size_t slot;
+  uint32_t generation;
+  uint64_t sent_us;
+  uint8_t data[ble::kMaxBroadcastLen];
+  size_t len;
+};
+
+AirPacket* newPacket(size_t from, size_t to, const uint8_t* data, size_t len) {
+  AirPacket* packet = new AirPacket();
+  packet->from = from;
+  packet->to = to;
+  packet->sent_us = sim::nowUs();
+  packet->len = len < sizeof(packet->data) ? len : sizeof(packet->data);
+  memcpy(packet->data, data, packet->len);
+  return packet;
+}
+
+void tap(const AirPacket& packet, bool advert) {
+  if (g_air_tap != nullptr) {
+    const sim::AirFrame frame = {packet.from, packet.to, packet.sent_us, advert, packet.data, packet.len};
+    g_air_tap(frame);
+  }
+}
+
+void airDeliverAdvert(void* ctx) {
+  AirPacket* packet = static_cast<AirPacket*>(ctx);
+  const Radio& r = radio();
+  if (r.scanning && packet->generation == r.scan_generation && r.on_advert != nullptr) {
+    r.on_advert(nodeAddress(packet->from), airRssi(packet->from), packet->data, packet->len);
+    ++sim::stats().advertsReceived;
+    tap(*packet, true);
+  }
+  delete packet;
+}
+
+// Puts one advert of the current node's broadcast on the air and schedules
+// the next; ctx is the broadcast generation.
+void airAdvertise(void* ctx) {
+  const size_t from = sim::currentNode();
+  const Radio& sender = g_radios[from];
+  const uint32_t generation = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ctx));
+  if (!sender.broadcasting || generation != sender.broadcast_generation) {
+    return;
+  }
+  for (size_t to = 0; to < sim::nodeCount(); ++to) {
+    const Radio& r = g_radios[to];
+    if (to == from || !r.scanning || r.scan_company_id != sender.company_id || airLost()) {
+      continue;
+    }
+    AirPacket* packet = newPacket(from, to, sender.adv_data, sender.adv_len);
+    packet->generation = r.scan_generation;
+    sim::scheduleOn(to, sim::nowUs() + g_air.latencyMs * 1000ULL, airDeliverAdvert, packet);
+  }
+  sim::schedule(sim::nowUs() + sender.adv_interval_ms * 1000ULL, airAdvertise, ctx);
+}
+
+void airDeliverNotify(void* ctx) {
+  AirPacket* packet = static_cast<AirPacket*>(ctx);
+  Link& link = radio().links[packet->slot];
+  if (link.up && packet->generation == link.generation && link.on_notify != nullptr) {
+    link.on_notify(nodeAddress(packet->from), link.rssi, packet->data, packet->len);
+    link.rssi = airRssi(packet->from);
+    ++sim::stats().notifiesReceived;
+    tap(*packet, false);
+  }
+  delete packet;
+}
+
+// ctx is the peripheral node whose link the current node just lost.
+void airLinkDown(void* ctx) {
+  const size_t peripheral = reinterpret_cast<uintptr_t>(ctx);
+  const Radio& r = radio();
+  ++sim::stats().linkDrops;
+  if (r.on_link_down != nullptr) {
+    r.on_link_down(nodeAddress(peripheral));
+  }
+}
+
+// Ends link `slot` of node `central`. The peripheral advertises again, as
+// the Arduino server restarts advertising on disconnect. Unless the central
+// asked for it, the central hears of it `latencyMs` later.
+void closeAirLink(size_t central, size_t slot, bool centralAsked) {
+  Link& link = g_radios[central].links[slot];
+  if (!link.up) {
+    return;
+  }
+  link.up = false;
+  ++link.generation;
+  Radio& p = g_radios[link.peer];
+  if (p.linked && p.central == central && p.central_slot == slot) {
+    p.linked = false;
+  }
+  if (!centralAsked) {
+    sim::scheduleOn(central, sim::nowUs() + g_air.latencyMs * 1000ULL, airLinkDown,
+                    reinterpret_cast<void*>(static_cast<uintptr_t>(link.peer)));
+  }
+}
+
+// ctx packs the link generation (high bits) and the slot (low byte) of the
+// current node's link to fail.
+void airDropLink(void* ctx) {
+  const uintptr_t packed = reinterpret_cast<uintptr_t>(ctx);
+  const Link& link = radio().links[packed & 0xFF];
+  if (link.up && static_cast<uint32_t>(packed >> 8) == link.generation) {
+    closeAirLink(sim::currentNode(), packed & 0xFF, false);
+  }
+}
+
+// Peripheral nodes a scan from the current node hears: advertising and free.
+size_t airAdvertisers(ble::Address* out, size_t maxOut) {
+  size_t found = 0;
+  for (size_t node = 0; node < sim::nodeCount() && found < maxOut; ++node) {
+    const Radio& r = g_radios[node];
+    if (node != sim::currentNode() && r.advertising && !r.linked) {
+      out[found++] = nodeAddress(node);
+    }
+  }
+  return found;
+}
+
+// Links the current node to peripheral node `peer` after `setupUs` of
+// connection setup.
+ble::ConnectResult airConnect(const ble::Address& peer, uint64_t setupUs, ble::NotifyHandler onNotify) {
+  const size_t target = findNode(peer);
+  if (target == sim::kMaxNodes) {
+    return ble::ConnectResult::kConnectFailed;
+  }
+  if (freeLink() == ble::kMaxLinks) {
+    return ble::ConnectResult::kNoFreeLink;
+  }
+  sim::advanceUs(g_air.latencyMs * 1000ULL + setupUs);
+  Radio& p = g_radios[target];
+  const size_t slot = freeLink();
+  if (!p.advertising || p.linked || slot == ble::kMaxLinks) {
+    return ble::ConnectResult::kConnectFailed;
+  }
+  ++sim::stats().connects;
+  sim::stats().connectUs += g_air.latencyMs * 1000ULL + setupUs;
+
+  Link& link = radio().links[slot];
+  link.up = true;
+  link.peer = target;
+  link.address = peer;
+  link.on_notify = onNotify;
+  link.rssi = airRssi(target);
+  ++link.generation;
+  p.linked = true;
+  p.central = sim::currentNode();
+  p.central_slot = slot;
+  p.rx_free_us = 0;
+  if (g_air.dropMeanMs != 0) {
+    const double uniform = (airRandom() % 1000000 + 1) / 1000001.0;
+    const uint64_t uptime_us = static_cast<uint64_t>(-log(uniform) * g_air.dropMeanMs * 1000.0);
+    const uintptr_t packed = (static_cast<uintptr_t>(link.generation) << 8) | slot;
+    sim::schedule(sim::nowUs() + uptime_us, airDropLink, reinterpret_cast<void*>(packed));
+  }
+  return ble::ConnectResult::kOk;
+}
+
+}  // namespace
+
+namespace sim {
+
+void setBlePeer(const BlePeerOptions& options) {
+  g_peer = options;
+  if (g_peer.payloadLen > sizeof(g_peer.payload)) {
+    g_peer.payloadLen = sizeof(g_peer.payload);
+  }
+  if (g_peer.count == 0) {
+    g_peer.count = 1;
+  } else if (g_peer.count > kMaxBlePeers) {
+    g_peer.count = kMaxBlePeers;
+  }
+  for (size_t peer = 0; peer < g_peer.count; ++peer) {
+    memcpy(g_peer_payload[peer], g_peer.payload, g_peer.payloadLen);
+  }
+}
+
+void setAir(const AirOptions& options) {
+  g_air = options;
+  g_air_enabled = true;
+  g_peer.enabled = false;
+}
+
+void setAirTap(AirTap tap) { g_air_tap = tap; }
+
+}  // namespace sim
+
+namespace ble {
+
+bool init(const char* /*deviceName*/) {
+  Radio& r = radio();
+  if (!r.initialized) {
+    r.init_us = sim::nowUs();
+  }
+  r.initialized = true;
+  ++sim::stats().bleInits;
+  return true;
+}
+
+void deinit() {
+  stopPeripheral();
+  stopBroadcast();
+  disconnectAll();
+  stopScan();
+  Radio& r = radio();
+  if (r.initialized) {
+    sim::stats().radioOnUs += sim::nowUs() - r.init_us;
+  }
+  r.initialized = false;
+}
+
+bool startPeripheral(const char* /*serviceUuid*/, const char* /*charUuid*/) {
+  Radio& r = radio();
+  if (!r.initialized) {
+    return false;
+  }
+  r.advertising = true;
+  r.adv_start_us = sim::nowUs();
+  return true;
+}
+
+bool peripheralConnected() {
+  const Radio& r = radio();
+  if (g_air_enabled) {
+    return r.linked;
+  }
+  return r.advertising && g_peer.enabled &&
+         sim::nowUs() - r.adv_start_us >= g_peer.connectLatencyMs * 1000ULL;
+}
+
+bool notify(const uint8_t* data, size_t len) {
+  if (!peripheralConnected()) {
+    return false;
+  }
+  ++sim::stats().notifiesSent;
+  Serial.print("[SIM] notify ");
+  printHex(data, len);
+  Serial.println();
+  if (g_air_enabled) {
+    Radio& r = radio();
+    uint64_t delay_us = g_air.latencyMs * 1000ULL;
+    for (int retry = 0; retry < kAirMaxRetries && airLost(); ++retry) {
+      delay_us += kAirConnIntervalUs;
+    }
+    uint64_t at_us = sim::nowUs() + delay_us;
+    at_us = at_us > r.rx_free_us ? at_us : r.rx_free_us;
+    r.rx_free_us = at_us;
+    AirPacket* packet = newPacket(sim::currentNode(), r.central, data, len);
+    packet->slot = r.central_slot;
+    packet->generation = g_radios[r.central].links[r.central_slot].generation;
+    sim::scheduleOn(r.central, at_us, airDeliverNotify, packet);
+  }
+  return true;
+}
+
+void stopPeripheral() {
+  Radio& r = radio();
+  if (g_air_enabled && r.linked) {
+    closeAirLink(r.central, r.central_slot, false);
+  }
+  r.advertising = false;
+}
+
+bool startBroadcast(uint16_t companyId, const uint8_t* data, size_t len, uint16_t intervalMs) {
+  Radio& r = radio();
+  if (!r.initialized || len > kMaxBroadcastLen) {
+    return false;
+  }
+  r.broadcasting = true;
+  r.company_id = companyId;
+  r.adv_interval_ms = intervalMs;
+  memcpy(r.adv_data, data, len);
+  r.adv_len = len;
+  ++r.broadcast_generation;
+  ++sim::stats().broadcasts;
+  Serial.print("[SIM] broadcast company=");
+  Serial.print(static_cast<unsigned int>(companyId));
+  Serial.print(" every ");
+  Serial.print(static_cast<unsigned int>(intervalMs));
+  Serial.print(" ms ");
+  printHex(data, len);
+  Serial.println();
+  if (g_air_enabled) {
+    const uintptr_t generation = r.broadcast_generation;
+    sim::schedule(sim::nowUs(), airAdvertise, reinterpret_cast<void*>(generation));
+  }
+  return true;
+}
+
+void stopBroadcast() {
+  Radio& r = radio();
+  r.broadcasting = false;
+  ++r.broadcast_generation;
+}
+
+size_t scanForService(const char* /*serviceUuid*/, uint32_t seconds, Address* out, size_t maxOut) {
+  if (!radio().initialized) {
+    return 0;
+  }
+  const uint64_t full_us = static_cast<uint64_t>(seconds) * 1000000ULL;
+  if (g_air_enabled) {
+    // Heard one advertising interval after they start, or not at all.
+    uint64_t scan_us = 0;
+    size_t found = 0;
+    while (found < maxOut && scan_us < full_us) {
+      const uint64_t left_us = full_us - scan_us;
+      const uint64_t step_us = left_us < kPeerAdvIntervalUs ? left_us : kPeerAdvIntervalUs;
+      sim::advanceUs(step_us);
+      scan_us += step_us;
+      found = airAdvertisers(out, maxOut);
+    }
+    ++sim::stats().scans;
+    sim::stats().scanUs += scan_us;
+    return found;
+  }
+
+  // A linked phantom stops advertising, like the tag's peripheral does.
+  size_t found = 0;
+  for (size_t peer = 0; g_peer.enabled && peer < g_peer.count && found < maxOut; ++peer) {
+    if (findLink(peerAddress(peer)) == kMaxLinks) {
+      out[found++] = peerAddress(peer);
+    }
+  }
+  // Like the Arduino scan this blocks, but only until `maxOut` peers are seen.
+  const uint64_t scan_us = found == maxOut && kPeerAdvIntervalUs < full_us ? kPeerAdvIntervalUs : full_us;
+  sim::advanceUs(scan_us);
+  ++sim::stats().scans;
+  sim::stats().scanUs += scan_us;
+  return found;
+}
+
+namespace {
+
+// Claims a link slot for `peer` after `setupUs` of connection setup; returns
+// kMaxLinks if the phantom does not exist or every slot is taken.
+size_t openLink(const Address& peer, uint64_t setupUs, NotifyHandler onNotify) {
+  const size_t index = findPeer(peer);
+  if (!g_peer.enabled || index == g_peer.count) {
+    return kMaxLinks;
+  }
+  size_t slot = findLink(peer);
+  if (slot == kMaxLinks) {
+    slot = freeLink();
+  }
+  if (slot == kMaxLinks) {
+    return kMaxLinks;
+  }
+  sim::advanceUs(setupUs);
+  ++sim::stats().connects;
+  sim::stats().connectUs += setupUs;
+
+  Link& link = radio().links[slot];
+  link.up = true;
+  link.peer = index;
+  link.address = peer;
+  link.on_notify = onNotify;
+  link.rssi = peerRssi(index);
+  ++link.generation;
+  const uintptr_t packed = (static_cast<uintptr_t>(link.generation) << 8) | slot;
+  sim::schedule(sim::nowUs() + g_peer.notifyPeriodMs * 1000ULL, peerNotify, reinterpret_cast<void*>(packed));
+  if (g_peer.linkDropMs != 0) {
+    sim::schedule(sim::nowUs() + g_peer.linkDropMs * 1000ULL, peerDropLink, reinterpret_cast<void*>(packed));
+  }
+  return slot;
+}
+
+}  // namespace
+
+ConnectResult connect(const Address& peer, const char* /*serviceUuid*/, const char* /*charUuid*/,
+                      NotifyHandler onNotify, GattHandles* resolved) {
+  if (g_air_enabled) {
+    const ConnectResult result = airConnect(peer, kPeerDiscoveryUs, onNotify);
+    if (result == ConnectResult::kOk && resolved != nullptr) {
+      *resolved = kPeerHandles;
+    }
+    return result;
+  }
+  if (findPeer(peer) == g_peer.count || !g_peer.enabled) {
+    return ConnectResult::kConnectFailed;
+  }
+  const uint64_t setup_us = g_peer.connectLatencyMs * 1000ULL + kPeerDiscoveryUs;
+  if (openLink(peer, setup_us, onNotify) == kMaxLinks) {
+    return ConnectResult::kNoFreeLink;
+  }
+  if (resolved != nullptr) {
+    *resolved = kPeerHandles;
+  }
+  return ConnectResult::kOk;
+}
+
+ConnectResult connectCached(const Address& peer, const GattHandles& handles, NotifyHandler onNotify) {
+  const bool stale = handles.value != kPeerHandles.value || handles.cccd != kPeerHandles.cccd;
+  if (g_air_enabled) {
+    if (stale) {
+      sim::advanceUs(g_air.latencyMs * 1000ULL + kPeerCccdWriteUs);
+      return ConnectResult::kSubscribeFailed;
+    }
+    return airConnect(peer, kPeerCccdWriteUs, onNotify);
+  }
+  if (findPeer(peer) == g_peer.count || !g_peer.enabled) {
+    return ConnectResult::kConnectFailed;
+  }
+  if (stale) {
+    // The phantom answers the CCCD write with an error; the link is dropped.
+    sim::advanceUs(g_peer.connectLatencyMs * 1000ULL + kPeerCccdWriteUs);
+    return ConnectResult::kSubscribeFailed;
+  }
+  const uint64_t setup_us = g_peer.connectLatencyMs * 1000ULL + kPeerCccdWriteUs;
+  return openLink(peer, setup_us, onNotify) == kMaxLinks ? ConnectResult::kNoFreeLink : ConnectResult::kOk;
+}
+
+bool centralConnected(const Address& peer) { return findLink(peer) != kMaxLinks; }
+
+void setLinkDownHandler(LinkDownHandler onLinkDown) { radio().on_link_down = onLinkDown; }
+
+size_t centralLinks() {
+  size_t up = 0;
+  for (const Link& link : radio().links) {
+    up += link.up ? 1 : 0;
+  }
+  return up;
+}
+
+void disconnect(const Address& peer) {
+  const size_t slot = findLink(peer);
+  if (slot == kMaxLinks) {
+    return;
+  }
+  if (g_air_enabled) {
+    closeAirLink(sim::currentNode(), slot, true);
+    return;
+  }
+  radio().links[slot].up = false;
+  ++radio().links[slot].generation;
+}
+
+void disconnectAll() {
+  for (size_t slot = 0; slot < kMaxLinks; ++slot) {
+    Link& link = radio().links[slot];
+    if (g_air_enabled) {
+      closeAirLink(sim::currentNode(), slot, true);
+    } else {
+      link.up = false;
+      ++link.generation;
+    }
+  }
+}
+
+bool startPassiveScan(uint16_t companyId, uint16_t /*intervalMs*/, AdvertHandler onAdvert) {
+  Radio& r = radio();
+  if (!r.initialized) {
+    return false;
+  }
+  r.on_advert = onAdvert;
+  r.scan_company_id = companyId;
+  r.scanning = true;
+  ++r.scan_generation;
+  for (size_t peer = 0; g_peer.enabled && peer < g_peer.count; ++peer) {
+    const uintptr_t packed = (static_cast<uintptr_t>(r.scan_generation) << 16) | (peer << 8);
+    sim::schedule(peerPhaseUs(peer, sim::nowUs()), peerAdvert, reinterpret_cast<void*>(packed));
+  }
+  return true;
+}
+
+bool scanning() { return radio().scanning; }
+
+void stopScan() {
+  Radio& r = radio();
+  r.scanning = false;
+  ++r.scan_generation;
+}
+
+}  // namespace ble
+}  // namespace hal
+
+#endif  // HAL_NATIVE
@@ -0,0 +1,75 @@
+#ifdef HAL_NATIVE
+
+#include "hal/ble.h"
+#include "hal/events.h"
+#include "hal/sim.h"
+
+namespace hal {
+namespace events {
+
+namespace {
+
+struct Queue {
+  uint8_t ring[kQueueDepth];
+  size_t head;
+  size_t count;
+  bool auto_light_sleep;
+  int awake_holds;
+};
+
+Queue g_queues[sim::kMaxNodes] = {};
+
+Queue& queue() { return g_queues[sim::currentNode()]; }
+
+bool queued(void* /*ctx*/) { return queue().count != 0; }
+
+}  // namespace
+
+bool begin() { return true; }
+
+bool post(uint8_t event) {
+  Queue& q = queue();
+  if (q.count == kQueueDepth) {
+    return false;
+  }
+  q.ring[(q.head + q.count) % kQueueDepth] = event;
+  ++q.count;
+  return true;
+}
+
+bool postFromIsr(uint8_t event) { return post(event); }
+
+// Virtual time runs until a scheduled event posts something. With automatic
+// light sleep the wait counts as one light sleep, unless a continuous passive
+// scan keeps the radio, and so the chip, awake, or holdAwake() is held.
+bool wait(uint8_t* event, uint32_t timeoutMs) {
+  Queue& q = queue();
+  if (q.count == 0) {
+    const uint64_t start_us = sim::nowUs();
+    sim::advanceUntil(timeoutMs * 1000ULL, queued, nullptr);
+    if (q.auto_light_sleep && q.awake_holds == 0 && !ble::scanning()) {
+      sim::Stats& s = sim::stats();
+      ++s.lightSleeps;
+      s.lightSleepUs += sim::nowUs() - start_us;
+    }
+  }
+  if (q.count == 0) {
+    return false;
+  }
+  *event = q.ring[q.head];
+  q.head = (q.head + 1) % kQueueDepth;
+  --q.count;
+  return true;
+}
+
+bool enableAutoLightSleep() {
+  queue().auto_light_sleep = true;
+  return true;
+}
+
+void holdAwake(bool hold) { queue().awake_holds += hold ? 1 : -1; }
+
+}  // namespace events
+}  // namespace hal
+
+#endif  // HAL_NATIVE
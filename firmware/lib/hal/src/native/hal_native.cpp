@@ -0,0 +1,510 @@
+#ifdef HAL_NATIVE
+
+#include <stdio.h>
+#include <ucontext.h>
+
+#include <map>
+#include <vector>
+
+#include "hal/clock.h"
+#include "hal/console.h"
+#include "hal/critical.h"
+#include "hal/gpio.h"
+#include "hal/i2c.h"
+#include "hal/pwm.h"
+#include "hal/sim.h"
+#include "hal/sleep.h"
+#include "hal/timer.h"
+
+hal::sim::Console Serial;
+
+namespace hal {
+
+namespace sim {
+
+namespace {
+
+struct Event {
+  EventFn fn;
+  void* ctx;
+  size_t node;  // runs as this node
+};
+
+uint64_t g_now_us = 0;
+std::multimap<uint64_t, Event> g_events;
+
+constexpr int kMaxPins = 32;
+
+// Everything one simulated device owns in this file.
+struct Node {
+  const char* name = nullptr;
+  EntryFn setup = nullptr;
+  EntryFn loop = nullptr;
+
+  bool pin_level[kMaxPins] = {};
+  int analog[kMaxPins] = {};
+  gpio::IsrCallback pin_isr[kMaxPins] = {};
+  gpio::Edge pin_edge[kMaxPins] = {};
+  uint32_t pwm_duty[pwm::kMaxChannels] = {};
+  int pwm_pin[pwm::kMaxChannels] = {-1, -1, -1, -1, -1, -1};
+  std::map<uint8_t, I2cDevice*> i2c;
+  Stats stats = {};
+  bool at_line_start = true;
+
+  timer::Callback alarm_callback = nullptr;
+  uint32_t alarm_generation = 0;
+
+  sleep::WakeCause wake_cause = sleep::WakeCause::kPowerOn;
+  int gpio_wake_pin = -1;
+  bool gpio_wake_high = true;
+
+  // runNodes(): the node's own stack, and what it is blocked on.
+  ucontext_t context;
+  std::vector<char> stack;
+  bool waiting = false;
+  bool (*stop)(void* ctx) = nullptr;
+  void* stop_ctx = nullptr;
+  bool woke_early = false;
+  uint32_t wake_generation = 0;
+};
+
+Node g_nodes[kMaxNodes];
+size_t g_node_count = 1;
+size_t g_current = 0;
+bool g_running_nodes = false;
+bool g_console_enabled = true;
+ucontext_t g_host_context;
+
+constexpr size_t kNodeStackBytes = 256 * 1024;
+
+Node& here() { return g_nodes[g_current]; }
+
+bool validPin(int pin) { return pin >= 0 && pin < kMaxPins; }
+
+struct PinWait {
+  int pin;
+  bool level;
+};
+
+bool pinReached(void* ctx) {
+  const PinWait* wait = static_cast<const PinWait*>(ctx);
+  return validPin(wait->pin) && here().pin_level[wait->pin] == wait->level;
+}
+
+// Pops the earliest event due by `target` and runs it as its node.
+bool runNextEvent(uint64_t target) {
+  if (g_events.empty() || g_events.begin()->first > target) {
+    return false;
+  }
+  const auto it = g_events.begin();
+  const Event ev = it->second;
+  if (it->first > g_now_us) {
+    g_now_us = it->first;
+  }
+  g_events.erase(it);
+  g_current = ev.node;
+  ev.fn(ev.ctx);
+  return true;
+}
+
+// Switches to `node` until it blocks again.
+void resumeNode(size_t node, bool early) {
+  Node& n = g_nodes[node];
+  n.waiting = false;
+  n.woke_early = early;
+  g_current = node;
+  swapcontext(&g_host_context, &n.context);
+}
+
+void wakeNode(void* ctx) {
+  const uintptr_t packed = reinterpret_cast<uintptr_t>(ctx);
+  const size_t node = packed & 0xFF;
+  const Node& n = g_nodes[node];
+  if (n.waiting && static_cast<uint32_t>(packed >> 8) == n.wake_generation) {
+    resumeNode(node, false);
+  }
+}
+
+// Resumes every blocked node whose stop condition now holds, until none is.
+void resumeStoppedNodes() {
+  bool resumed = true;
+  while (resumed) {
+    resumed = false;
+    for (size_t i = 0; i < g_node_count; ++i) {
+      Node& n = g_nodes[i];
+      g_current = i;
+      if (n.waiting && n.stop != nullptr && n.stop(n.stop_ctx)) {
+        resumeNode(i, true);
+        resumed = true;
+      }
+    }
+  }
+}
+
+// Node side of advanceUntil() under runNodes(): hands control back to the
+// scheduler until the deadline passes or the stop condition holds.
+bool blockNode(uint64_t us, bool (*stop)(void* ctx), void* ctx) {
+  const size_t node = g_current;
+  Node& n = g_nodes[node];
+  n.waiting = true;
+  n.stop = stop;
+  n.stop_ctx = ctx;
+  ++n.wake_generation;
+  const uintptr_t packed = (static_cast<uintptr_t>(n.wake_generation) << 8) | node;
+  scheduleOn(node, g_now_us + us, wakeNode, reinterpret_cast<void*>(packed));
+  swapcontext(&n.context, &g_host_context);
+  g_current = node;
+  return n.woke_early;
+}
+
+void nodeMain() {
+  Node& n = here();
+  n.setup();
+  for (;;) {
+    n.loop();
+    ++n.stats.loopIterations;
+    advanceUs(kLoopOverheadUs);
+  }
+}
+
+}  // namespace
+
+uint64_t nowUs() { return g_now_us; }
+
+// Runs events up to `us` from now, stopping early (with the clock at the
+// event that caused it) once `stop` holds. Returns true on an early stop.
+bool advanceUntil(uint64_t us, bool (*stop)(void* ctx), void* ctx) {
+  if (g_running_nodes) {
+    return blockNode(us, stop, ctx);
+  }
+  const uint64_t target = g_now_us + us;
+  const size_t node = g_current;
+  while (runNextEvent(target)) {
+    g_current = node;
+    if (stop != nullptr && stop(ctx)) {
+      return true;
+    }
+  }
+  g_current = node;
+  g_now_us = target;
+  return false;
+}
+
+// A negative pin never stops.
+bool advanceUntilPin(uint64_t us, int pin, bool level) {
+  PinWait wait = {pin, level};
+  return advanceUntil(us, pinReached, &wait);
+}
+
+void advanceUs(uint64_t us) { advanceUntil(us, nullptr, nullptr); }
+
+void schedule(uint64_t atUs, EventFn fn, void* ctx) { scheduleOn(g_current, atUs, fn, ctx); }
+
+void scheduleOn(size_t node, uint64_t atUs, EventFn fn, void* ctx) {
+  g_events.insert(std::make_pair(atUs, Event{fn, ctx, node}));
+}
+
+// ---- Nodes ----
+
+size_t addNode(const char* name, EntryFn setup, EntryFn loop) {
+  size_t node = 0;
+  if (g_nodes[0].setup != nullptr) {
+    if (g_node_count == kMaxNodes) {
+      return kMaxNodes;
+    }
+    node = g_node_count++;
+  }
+  g_nodes[node].name = name;
+  g_nodes[node].setup = setup;
+  g_nodes[node].loop = loop;
+  return node;
+}
+
+size_t nodeCount() { return g_node_count; }
+size_t currentNode() { return g_current; }
+const char* nodeName(size_t node) { return node < g_node_count ? g_nodes[node].name : nullptr; }
+
+void selectNode(size_t node) {
+  if (node < g_node_count) {
+    g_current = node;
+  }
+}
+
+void runNodes(uint64_t untilUs) {
+  for (size_t i = 0; i < g_node_count; ++i) {
+    Node& n = g_nodes[i];
+    n.stack.resize(kNodeStackBytes);
+    getcontext(&n.context);
+    n.context.uc_stack.ss_sp = n.stack.data();
+    n.context.uc_stack.ss_size = n.stack.size();
+    n.context.uc_link = nullptr;
+    makecontext(&n.context, nodeMain, 0);
+  }
+  g_running_nodes = true;
+  for (size_t i = 0; i < g_node_count; ++i) {
+    resumeNode(i, false);
+  }
+  for (;;) {
+    resumeStoppedNodes();
+    if (!runNextEvent(untilUs)) {
+      break;
+    }
+  }
+  // The nodes stay parked mid-call; their stacks are simply abandoned.
+  g_running_nodes = false;
+  if (g_now_us < untilUs) {
+    g_now_us = untilUs;
+  }
+}
+
+bool pinLevel(int pin) { return validPin(pin) && here().pin_level[pin]; }
+
+void setInputLevel(int pin, bool high) {
+  Node& n = here();
+  if (!validPin(pin) || n.pin_level[pin] == high) {
+    return;
+  }
+  n.pin_level[pin] = high;
+  if (n.pin_isr[pin] != nullptr && high == (n.pin_edge[pin] == gpio::Edge::kRising)) {
+    n.pin_isr[pin]();
+  }
+}
+
+uint32_t pwmDuty(uint8_t channel) { return channel < pwm::kMaxChannels ? here().pwm_duty[channel] : 0; }
+
+void setAnalogValue(int pin, int raw) {
+  if (validPin(pin)) {
+    here().analog[pin] = raw;
+  }
+}
+
+void attachI2c(uint8_t addr, I2cDevice* device) { here().i2c[addr] = device; }
+
+I2cDevice* findI2c(uint8_t addr) {
+  const std::map<uint8_t, I2cDevice*>& bus = here().i2c;
+  const auto it = bus.find(addr);
+  return it == bus.end() ? nullptr : it->second;
+}
+
+Stats& stats() { return here().stats; }
+
+// ---- Console ----
+
+void setConsoleEnabled(bool enabled) { g_console_enabled = enabled; }
+
+// With several nodes every line also names the node that printed it.
+void Console::write(const char* s) {
+  Node& n = here();
+  if (!g_console_enabled) {
+    return;
+  }
+  for (; *s != '\0'; ++s) {
+    if (n.at_line_start) {
+      const uint64_t ms = g_now_us / 1000ULL;
+      printf("[%7llu.%03llu] ", static_cast<unsigned long long>(ms / 1000ULL),
+             static_cast<unsigned long long>(ms % 1000ULL));
+      if (g_node_count > 1) {
+        printf("%s: ", n.name);
+      }
+      n.at_line_start = false;
+    }
+    putchar(*s);
+    if (*s == '\n') {
+      n.at_line_start = true;
+    }
+  }
+}
+
+void Console::flush() { fflush(stdout); }
+void Console::print(const char* s) { write(s); }
+
+void Console::print(char c) {
+  const char buf[2] = {c, '\0'};
+  write(buf);
+}
+
+void Console::print(long long v) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%lld", v);
+  write(buf);
+}
+
+void Console::print(unsigned long long v) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), "%llu", v);
+  write(buf);
+}
+
+void Console::print(double v, int digits) {
+  char buf[40];
+  snprintf(buf, sizeof(buf), "%.*f", digits, v);
+  write(buf);
+}
+
+void Console::println() { write("\n"); }
+
+}  // namespace sim
+
+// Timer callbacks only run inside advanceUs(), never concurrently with the
+// caller (nor do other nodes), so there is nothing to mask.
+void enterCritical() {}
+void exitCritical() {}
+
+namespace clock {
+
+uint32_t millis() { return static_cast<uint32_t>(sim::nowUs() / 1000ULL); }
+uint32_t micros() { return static_cast<uint32_t>(sim::nowUs()); }
+void delayMs(uint32_t ms) { sim::advanceUs(static_cast<uint64_t>(ms) * 1000ULL); }
+void delayUs(uint32_t us) { sim::advanceUs(us); }
+uint32_t rtcSeconds() { return static_cast<uint32_t>(sim::nowUs() / 1000000ULL); }
+
+}  // namespace clock
+
+namespace gpio {
+
+void configure(int /*pin*/, Mode /*mode*/) {}
+
+void write(int pin, bool high) {
+  if (sim::validPin(pin)) {
+    sim::here().pin_level[pin] = high;
+  }
+}
+
+bool read(int pin) { return sim::pinLevel(pin); }
+
+int analogRead(int pin) { return sim::validPin(pin) ? sim::here().analog[pin] : 0; }
+// An ideal 12-bit ADC over the calibrated 11 dB range.
+int analogReadMv(int pin) { return analogRead(pin) * sim::kAdcFullScaleMv / 4095; }
+
+void writeMasked(uint32_t mask, uint32_t levels) {
+  for (int pin = 0; pin < sim::kMaxPins; ++pin) {
+    if ((mask & pinMask(pin)) != 0) {
+      sim::here().pin_level[pin] = (levels & pinMask(pin)) != 0;
+    }
+  }
+}
+
+bool attachInterrupt(int pin, Edge edge, IsrCallback onEdge) {
+  if (!sim::validPin(pin)) {
+    return false;
+  }
+  sim::here().pin_isr[pin] = onEdge;
+  sim::here().pin_edge[pin] = edge;
+  return true;
+}
+
+}  // namespace gpio
+
+namespace i2c {
+
+bool begin(int /*sda*/, int /*scl*/, uint32_t /*hz*/) { return true; }
+
+bool writeReg(uint8_t addr, uint8_t reg, uint8_t val) {
+  sim::I2cDevice* dev = sim::findI2c(addr);
+  return dev != nullptr && dev->writeReg(reg, val);
+}
+
+bool readRegs(uint8_t addr, uint8_t reg, uint8_t* out, size_t len) {
+  sim::I2cDevice* dev = sim::findI2c(addr);
+  if (dev == nullptr || len > kMaxReadLen) {
+    return false;
+  }
+  return dev->readRegs(reg, out, len);
+}
+
+}  // namespace i2c
+
+namespace pwm {
+
+bool attach(uint8_t channel, int pin, uint32_t /*hz*/, uint8_t /*bits*/) {
+  if (channel >= kMaxChannels || !sim::validPin(pin)) {
+    return false;
+  }
+  sim::here().pwm_pin[channel] = pin;
+  write(channel, 0);
+  return true;
+}
+
+// The pin reads high while the duty is non-zero.
+void write(uint8_t channel, uint32_t duty) {
+  sim::Node& n = sim::here();
+  if (channel < kMaxChannels && n.pwm_pin[channel] >= 0) {
+    n.pwm_duty[channel] = duty;
+    n.pin_level[n.pwm_pin[channel]] = duty != 0;
+  }
+}
+
+}  // namespace pwm
+
+namespace timer {
+
+namespace {
+
+void fireAlarm(void* ctx) {
+  const sim::Node& n = sim::here();
+  const uint32_t generation = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ctx));
+  if (generation == n.alarm_generation && n.alarm_callback != nullptr) {
+    n.alarm_callback();
+  }
+}
+
+}  // namespace
+
+bool begin(Callback onAlarm) {
+  sim::here().alarm_callback = onAlarm;
+  return true;
+}
+
+void armUs(uint32_t us) {
+  const uint32_t generation = ++sim::here().alarm_generation;
+  void* ctx = reinterpret_cast<void*>(static_cast<uintptr_t>(generation));
+  sim::schedule(sim::nowUs() + us, fireAlarm, ctx);
+}
+
+void cancel() { ++sim::here().alarm_generation; }
+
+}  // namespace timer
+
+namespace sleep {
+
+WakeCause wakeCause() { return sim::here().wake_cause; }
+
+bool enableGpioWake(int pin, bool high) {
+  if (pin < 0 || pin > 5) {
+    return false;
+  }
+  sim::here().gpio_wake_pin = pin;
+  sim::here().gpio_wake_high = high;
+  return true;
+}
+
+void lightUs(uint64_t us) {
+  sim::Stats& s = sim::stats();
+  ++s.lightSleeps;
+  s.lightSleepUs += us;
+  sim::advanceUs(us);
+}
+
+void deepUs(uint64_t us) {
+  sim::Node& n = sim::here();
+  ++n.stats.deepSleeps;
+  const uint64_t start_us = sim::nowUs();
+  // The chip samples wake pins continuously; a level already present when
+  // sleep starts wakes it straight away.
+  const bool pin_already = n.gpio_wake_pin >= 0 && sim::pinLevel(n.gpio_wake_pin) == n.gpio_wake_high;
+  if (pin_already || sim::advanceUntilPin(us, n.gpio_wake_pin, n.gpio_wake_high)) {
+    n.wake_cause = WakeCause::kGpio;
+    ++n.stats.gpioWakes;
+  } else {
+    n.wake_cause = WakeCause::kTimer;
+  }
+  n.stats.deepSleepUs += sim::nowUs() - start_us;
+  // Wake sources do not survive the reboot that follows a real deep sleep.
+  n.gpio_wake_pin = -1;
+}
+
+}  // namespace sleep
+
+}  // namespace hal
+
+#endif  // HAL_NATIVE
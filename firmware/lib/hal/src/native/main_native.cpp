@@ -0,0 +1,121 @@
+#if defined(HAL_NATIVE) && !defined(HAL_NATIVE_NO_MAIN)
+
+// Native entry point standing in for the Arduino core's main(): runs the
+// firmware's setup()/loop() against the simulated backend for a fixed span of
+// virtual time and prints a run summary.
+//
+//   program [--seconds N] [--ble-peer] [--peer-latency-ms N]
+//           [--peer-period-ms N] [--peer-payload HEX] [--peer-seq-offset N]
+//           [--peer-count N] [--peer-drop-ms N] [--peer-rssi DBM]
+//           [--peer-away-ms N] [--peer-away-rssi DBM] [--imu-int1-pin N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hal/console.h"
+#include "hal/sim.h"
+
+void setup();
+void loop();
+
+namespace {
+
+size_t parseHex(const char* hex, uint8_t* out, size_t cap) {
+  size_t n = 0;
+  while (hex[0] != '\0' && hex[1] != '\0' && n < cap) {
+    char byte[3] = {hex[0], hex[1], '\0'};
+    out[n++] = static_cast<uint8_t>(strtoul(byte, nullptr, 16));
+    hex += 2;
+  }
+  return n;
+}
+
+void printSummary(uint64_t runUs) {
+  const hal::sim::Stats& s = hal::sim::stats();
+  printf("\n--- native run summary ---\n");
+  printf("virtual time      %.3f s\n", runUs / 1e6);
+  printf("loop iterations   %u\n", s.loopIterations);
+  printf("deep sleeps       %u (%.3f s)\n", s.deepSleeps, s.deepSleepUs / 1e6);
+  printf("gpio wakes        %u\n", s.gpioWakes);
+  printf("light sleeps      %u (%.3f s)\n", s.lightSleeps, s.lightSleepUs / 1e6);
+  printf("awake time        %.3f s\n", (runUs - s.deepSleepUs - s.lightSleepUs) / 1e6);
+  printf("ble inits         %u\n", s.bleInits);
+  printf("radio on          %.3f s\n", s.radioOnUs / 1e6);
+  printf("notifies tx/rx    %u/%u\n", s.notifiesSent, s.notifiesReceived);
+  printf("broadcasts tx     %u\n", s.broadcasts);
+  printf("adverts rx        %u\n", s.advertsReceived);
+  printf("active scans      %u (%.3f s)\n", s.scans, s.scanUs / 1e6);
+  printf("central connects  %u (%.1f ms mean)\n", s.connects,
+         s.connects != 0 ? s.connectUs / 1e3 / s.connects : 0.0);
+  printf("link drops        %u\n", s.linkDrops);
+  printf("storage writes    %u\n", s.storageWrites);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint64_t run_seconds = 600;
+  hal::sim::BlePeerOptions peer = {};
+  peer.connectLatencyMs = 30;
+  peer.notifyPeriodMs = 30000;
+  // Default: a protocol v3 activity batch with one record (seq 0 at byte 1,
+  // age 0, 3700 mV, normal tier, boot epoch 1, activity 50, walking).
+  peer.payloadLen = parseHex("31000000000100f41c00013201", peer.payload, sizeof(peer.payload));
+  peer.seqOffset = 1;
+  peer.count = 1;
+  peer.rssiDbm = -60;
+  peer.awayRssiDbm = -90;
+
+  // The sensor tag wires LSM6DS3 INT1 to GPIO3.
+  int imu_int1_pin = 3;
+
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--seconds") == 0 && has_value) {
+      run_seconds = strtoull(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--ble-peer") == 0) {
+      peer.enabled = true;
+    } else if (strcmp(argv[i], "--peer-latency-ms") == 0 && has_value) {
+      peer.connectLatencyMs = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--peer-period-ms") == 0 && has_value) {
+      peer.notifyPeriodMs = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--peer-payload") == 0 && has_value) {
+      peer.payloadLen = parseHex(argv[++i], peer.payload, sizeof(peer.payload));
+    } else if (strcmp(argv[i], "--peer-drop-ms") == 0 && has_value) {
+      peer.linkDropMs = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--peer-count") == 0 && has_value) {
+      peer.count = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--peer-seq-offset") == 0 && has_value) {
+      peer.seqOffset = static_cast<size_t>(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--peer-rssi") == 0 && has_value) {
+      peer.rssiDbm = static_cast<int8_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--peer-away-rssi") == 0 && has_value) {
+      peer.awayRssiDbm = static_cast<int8_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--peer-away-ms") == 0 && has_value) {
+      peer.awayPeriodMs = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--imu-int1-pin") == 0 && has_value) {
+      imu_int1_pin = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "unknown option: %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  hal::sim::attachI2c(0x6A, &hal::sim::lsm6ds3());
+  hal::sim::setLsm6ds3Int1Pin(imu_int1_pin);
+  hal::sim::setBlePeer(peer);
+
+  const uint64_t end_us = run_seconds * 1000000ULL;
+  setup();
+  while (hal::sim::nowUs() < end_us) {
+    loop();
+    ++hal::sim::stats().loopIterations;
+    hal::sim::advanceUs(hal::sim::kLoopOverheadUs);
+  }
+  Serial.flush();
+  printSummary(hal::sim::nowUs());
+  return 0;
+}
+
+#endif  // HAL_NATIVE && !HAL_NATIVE_NO_MAIN
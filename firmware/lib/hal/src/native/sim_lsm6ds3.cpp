@@ -0,0 +1,277 @@
+#ifdef HAL_NATIVE
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "hal/sim.h"
+
+namespace hal {
+namespace sim {
+
+namespace {
+
+constexpr uint8_t kRegFifoCtrl1 = 0x06;
+constexpr uint8_t kRegFifoCtrl2 = 0x07;
+constexpr uint8_t kRegFifoCtrl5 = 0x0A;
+constexpr uint8_t kRegWhoAmI = 0x0F;
+constexpr uint8_t kRegCtrl1Xl = 0x10;
+constexpr uint8_t kRegWakeUpSrc = 0x1B;
+constexpr uint8_t kRegOutXL = 0x28;
+constexpr uint8_t kRegFifoStatus1 = 0x3A;
+constexpr uint8_t kRegFifoStatus2 = 0x3B;
+constexpr uint8_t kRegFifoDataOutL = 0x3E;
+constexpr uint8_t kRegTapCfg = 0x58;
+constexpr uint8_t kRegWakeUpThs = 0x5B;
+constexpr uint8_t kRegWakeUpDur = 0x5C;
+constexpr uint8_t kRegMd1Cfg = 0x5E;
+
+constexpr uint8_t kWakeUpSrcWuIa = 0x08;
+
+constexpr uint32_t kFifoMaxSamples = 4096 / 3;
+constexpr double kLsbPerG = 1.0 / 0.000061;
+constexpr double kPi = 3.14159265358979323846;
+
+uint32_t odrNibbleToHz(uint8_t nibble) {
+  static const uint32_t kHz[] = {0, 13, 26, 52, 104, 208, 416, 833, 1660, 3330, 6660};
+  return nibble < sizeof(kHz) / sizeof(kHz[0]) ? kHz[nibble] : 0;
+}
+
+class SimLsm6ds3 : public I2cDevice {
+ public:
+  SimLsm6ds3() { memset(regs_, 0, sizeof(regs_)); regs_[kRegWhoAmI] = 0x69; }
+
+  bool writeReg(uint8_t reg, uint8_t val) override {
+    if (reg >= sizeof(regs_)) {
+      return false;
+    }
+    regs_[reg] = val;
+    if (reg == kRegFifoCtrl5) {
+      fifo_start_us_ = nowUs();
+      fifo_words_read_ = 0;
+    }
+    if (reg == kRegCtrl1Xl || reg == kRegTapCfg || reg == kRegMd1Cfg) {
+      rearmWakeUp();
+    }
+    return true;
+  }
+
+  void setInt1Pin(int pin) {
+    int1_pin_ = pin;
+    driveInt1();
+  }
+
+  bool readRegs(uint8_t reg, uint8_t* out, size_t len) override {
+    if (reg == kRegFifoDataOutL) {
+      // Burst reads of FIFO_DATA_OUT roll back from 0x3F to 0x3E.
+      for (size_t i = 0; i + 1 < len; i += 2) {
+        const int16_t word = nextFifoWord();
+        out[i] = static_cast<uint8_t>(word & 0xFF);
+        out[i + 1] = static_cast<uint8_t>((word >> 8) & 0xFF);
+      }
+      return true;
+    }
+
+    for (size_t i = 0; i < len; ++i) {
+      out[i] = readByte(static_cast<uint8_t>(reg + i));
+    }
+    return true;
+  }
+
+ private:
+  uint32_t fifoOdrHz() const { return odrNibbleToHz((regs_[kRegFifoCtrl5] >> 3) & 0x0F); }
+  bool fifoEnabled() const { return (regs_[kRegFifoCtrl5] & 0x07) != 0 && fifoOdrHz() != 0; }
+
+  // FIFO_MODE 110: keep sampling when full, overwriting the oldest.
+  bool fifoContinuous() const { return (regs_[kRegFifoCtrl5] & 0x07) == 0x06; }
+
+  // Samples produced since the FIFO started (capped when it stops on full).
+  uint32_t fifoSamplesCollected() const {
+    if (!fifoEnabled()) {
+      return 0;
+    }
+    const uint64_t n = (nowUs() - fifo_start_us_) * fifoOdrHz() / 1000000ULL;
+    if (fifoContinuous()) {
+      return static_cast<uint32_t>(n);
+    }
+    return n > kFifoMaxSamples ? kFifoMaxSamples : static_cast<uint32_t>(n);
+  }
+
+  uint32_t fifoUnreadWords() const {
+    const uint32_t words = fifoSamplesCollected() * 3;
+    const uint32_t unread = words > fifo_words_read_ ? words - fifo_words_read_ : 0;
+    return unread > kFifoMaxSamples * 3 ? kFifoMaxSamples * 3 : unread;
+  }
+
+  int16_t nextFifoWord() {
+    if (fifoUnreadWords() == 0) {
+      return 0;
+    }
+    // In continuous mode anything older than a full FIFO has been overwritten.
+    const uint32_t words = fifoSamplesCollected() * 3;
+    if (words - fifo_words_read_ > kFifoMaxSamples * 3) {
+      fifo_words_read_ = words - kFifoMaxSamples * 3;
+    }
+    const uint32_t index = fifo_words_read_++;
+    const uint64_t t_us = fifo_start_us_ + (static_cast<uint64_t>(index / 3) * 1000000ULL) / fifoOdrHz();
+    int16_t xyz[3];
+    signalAt(t_us, xyz);
+    return xyz[index % 3];
+  }
+
+  uint8_t readByte(uint8_t reg) {
+    if (reg >= kRegOutXL && reg < kRegOutXL + 6) {
+      int16_t xyz[3];
+      signalAt(nowUs(), xyz);
+      const int16_t v = xyz[(reg - kRegOutXL) / 2];
+      return static_cast<uint8_t>(((reg - kRegOutXL) & 1) ? (v >> 8) & 0xFF : v & 0xFF);
+    }
+    if (reg == kRegFifoStatus1) {
+      return static_cast<uint8_t>(fifoUnreadWords() & 0xFF);
+    }
+    if (reg == kRegFifoStatus2) {
+      const uint32_t unread = fifoUnreadWords();
+      const uint32_t watermark = regs_[kRegFifoCtrl1] | ((regs_[kRegFifoCtrl2] & 0x0F) << 8);
+      uint8_t status = static_cast<uint8_t>((unread >> 8) & 0x0F);
+      if (watermark != 0 && unread >= watermark) {
+        status |= 0x80;
+      }
+      if (unread >= kFifoMaxSamples * 3) {
+        status |= 0x20;
+      }
+      if (unread == 0) {
+        status |= 0x10;
+      }
+      return status;
+    }
+    if (reg == kRegWakeUpSrc) {
+      const uint8_t src = regs_[kRegWakeUpSrc];
+      if (latched()) {
+        regs_[kRegWakeUpSrc] = 0;
+        driveInt1();
+      }
+      return src;
+    }
+    return reg < sizeof(regs_) ? regs_[reg] : 0;
+  }
+
+  // ---- Wake-up interrupt ----
+  // Evaluated once per accelerometer ODR tick on the slope filter output
+  // (a[n] - a[n-1]) / 2 against WAKE_UP_THS in units of FS/64.
+
+  uint32_t accelOdrHz() const { return odrNibbleToHz((regs_[kRegCtrl1Xl] >> 4) & 0x0F); }
+  bool latched() const { return (regs_[kRegTapCfg] & 0x01) != 0; }
+
+  // Routed to INT1 with the accelerometer running; TAP_CFG has no enable.
+  bool wakeUpEnabled() const { return (regs_[kRegMd1Cfg] & 0x20) != 0 && accelOdrHz() != 0; }
+
+  void driveInt1() {
+    if (int1_pin_ >= 0) {
+      const bool active = (regs_[kRegMd1Cfg] & 0x20) != 0 && (regs_[kRegWakeUpSrc] & kWakeUpSrcWuIa) != 0;
+      setInputLevel(int1_pin_, active);
+    }
+  }
+
+  void rearmWakeUp() {
+    ++wake_generation_;
+    wake_count_ = 0;
+    if (wakeUpEnabled()) {
+      scheduleWakeTick();
+    }
+  }
+
+  void scheduleWakeTick() {
+    void* ctx = reinterpret_cast<void*>(static_cast<uintptr_t>(wake_generation_));
+    schedule(nowUs() + 1000000ULL / accelOdrHz(), onWakeTick, ctx);
+  }
+
+  static void onWakeTick(void* ctx);
+
+  void wakeTick() {
+    const uint64_t period_us = 1000000ULL / accelOdrHz();
+    int16_t now_xyz[3];
+    int16_t prev_xyz[3];
+    signalAt(nowUs(), now_xyz);
+    signalAt(nowUs() - period_us, prev_xyz);
+
+    const int32_t threshold = static_cast<int32_t>(regs_[kRegWakeUpThs] & 0x3F) * (32768 / 64);
+    uint8_t axes = 0;
+    for (int i = 0; i < 3; ++i) {
+      int32_t slope = (static_cast<int32_t>(now_xyz[i]) - prev_xyz[i]) / 2;
+      slope = slope < 0 ? -slope : slope;
+      if (threshold != 0 && slope > threshold) {
+        axes |= static_cast<uint8_t>(0x04 >> i);  // X_WU is bit 2, Z_WU bit 0
+      }
+    }
+
+    const uint8_t wake_dur = static_cast<uint8_t>((regs_[kRegWakeUpDur] >> 5) & 0x03);
+    wake_count_ = axes != 0 ? wake_count_ + 1 : 0;
+    if (wake_count_ > wake_dur) {
+      regs_[kRegWakeUpSrc] = static_cast<uint8_t>(kWakeUpSrcWuIa | axes);
+    } else if (!latched()) {
+      regs_[kRegWakeUpSrc] = 0;
+    }
+    driveInt1();
+    scheduleWakeTick();
+  }
+
+  // Gravity on Z plus a gait-like oscillation whose intensity follows a slow
+  // hourly rest/play cycle, with a little deterministic noise.
+  static void signalAt(uint64_t t_us, int16_t out[3]) {
+    const double t = static_cast<double>(t_us) / 1e6;
+    const double cycle = 0.5 * (1.0 + sin(2.0 * kPi * t / 3600.0));
+    const double intensity = cycle * cycle;
+    const double gait = sin(2.0 * kPi * 2.0 * t);
+
+    uint32_t h = static_cast<uint32_t>(t_us / 1000ULL) * 2654435761u;
+    h ^= h >> 15;
+    const double noise = (static_cast<double>(h & 0xFF) / 255.0 - 0.5) * 0.02;
+
+    const double g[3] = {
+        0.8 * intensity * gait + noise,
+        0.4 * intensity * gait * gait - noise,
+        1.0 + 0.3 * intensity * gait + noise,
+    };
+    for (int i = 0; i < 3; ++i) {
+      double lsb = g[i] * kLsbPerG;
+      if (lsb > 32767.0) {
+        lsb = 32767.0;
+      } else if (lsb < -32768.0) {
+        lsb = -32768.0;
+      }
+      out[i] = static_cast<int16_t>(lsb);
+    }
+  }
+
+  uint8_t regs_[0x80];
+  uint64_t fifo_start_us_ = 0;
+  uint32_t fifo_words_read_ = 0;
+  int int1_pin_ = -1;
+  uint32_t wake_generation_ = 0;
+  uint32_t wake_count_ = 0;
+};
+
+// One per node; a node's wake ticks run as that node.
+SimLsm6ds3& device() {
+  static SimLsm6ds3 instances[kMaxNodes];
+  return instances[currentNode()];
+}
+
+void SimLsm6ds3::onWakeTick(void* ctx) {
+  SimLsm6ds3& dev = device();
+  const uint32_t generation = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(ctx));
+  if (generation == dev.wake_generation_ && dev.wakeUpEnabled()) {
+    dev.wakeTick();
+  }
+}
+
+}  // namespace
+
+I2cDevice& lsm6ds3() { return device(); }
+
+void setLsm6ds3Int1Pin(int int1Pin) { device().setInt1Pin(int1Pin); }
+
+}  // namespace sim
+}  // namespace hal
+
+#endif  // HAL_NATIVE
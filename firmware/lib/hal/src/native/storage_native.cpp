@@ -0,0 +1,75 @@
+#ifdef HAL_NATIVE
+
+#include <string.h>
+
+#include "hal/sim.h"
+#include "hal/storage.h"
+
+namespace hal {
+namespace storage {
+
+namespace {
+
+struct Entry {
+  char key[16];
+  uint8_t data[256];
+  size_t len;
+};
+
+constexpr size_t kMaxEntries = 16;
+Entry g_entries[sim::kMaxNodes][kMaxEntries] = {};
+
+Entry* entries() { return g_entries[sim::currentNode()]; }
+
+Entry* find(const char* key) {
+  Entry* all = entries();
+  for (size_t i = 0; i < kMaxEntries; ++i) {
+    Entry& e = all[i];
+    if (e.key[0] != '\0' && strncmp(e.key, key, sizeof(e.key)) == 0) {
+      return &e;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+bool load(const char* key, void* out, size_t len) {
+  const Entry* e = find(key);
+  if (e == nullptr || e->len != len) {
+    return false;
+  }
+  memcpy(out, e->data, len);
+  return true;
+}
+
+bool save(const char* key, const void* data, size_t len) {
+  if (strlen(key) >= sizeof(Entry::key) || len > sizeof(Entry::data)) {
+    return false;
+  }
+  Entry* e = find(key);
+  Entry* all = entries();
+  for (size_t i = 0; e == nullptr && i < kMaxEntries; ++i) {
+    e = all[i].key[0] == '\0' ? &all[i] : nullptr;
+  }
+  if (e == nullptr) {
+    return false;
+  }
+  strncpy(e->key, key, sizeof(e->key) - 1);
+  memcpy(e->data, data, len);
+  e->len = len;
+  ++sim::stats().storageWrites;
+  return true;
+}
+
+void erase(const char* key) {
+  Entry* e = find(key);
+  if (e != nullptr) {
+    *e = Entry();
+  }
+}
+
+}  // namespace storage
+}  // namespace hal
+
+#endif  // HAL_NATIVE
@@ -0,0 +1,178 @@
+#ifndef PROTOCOL_ACTIVITY_BATCH_H
+#define PROTOCOL_ACTIVITY_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "protocol/protocol.h"
+
+// kActivityBatch, version 3: consecutive activity windows from one tag.
+//
+//   u8      header        headerByte(kActivityBatch)
+//   u32 LE  first_seq     sequence number of the first (oldest) record
+//   u8      count         records that follow, 1..kMaxRecords
+//   varint  first_age_s   age of the first record at transmission
+//   varint  battery_mv    battery at the newest window
+//   u8      power_tier    PowerTier the tag ran the newest window in
+//   u8      boot_epoch    changes every time the tag boots from reset
+//   count x {
+//     u8      activity    0-100
+//     varint  gap_class   (age gap to the previous record in s) << 2 | class
+//   }
+//
+// Records are oldest first with consecutive sequence numbers, so ages only
+// shrink and the gap (0 for the first record) is usually one byte at the
+// tag's 30 s cadence. A record therefore costs 2-3 bytes: 4-6 fit in one
+// notification, against 3 fixed-size records before. Version 2 added
+// power_tier. Version 3 added boot_epoch: a tag that loses its RTC memory
+// restarts its sequence numbers, and a new epoch tells the receiver so
+// instead of the records looking like replays.
+
+namespace protocol {
+
+#pragma pack(push, 1)
+// Fixed-position prefix; the varint fields follow it.
+struct ActivityBatchPrefix {
+  uint8_t header;
+  uint32_t first_seq;
+  uint8_t count;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(ActivityBatchPrefix) == 6, "ActivityBatchPrefix layout changed");
+static_assert(offsetof(ActivityBatchPrefix, first_seq) == 1, "first_seq must follow the header byte");
+static_assert(offsetof(ActivityBatchPrefix, count) == 5, "count must follow first_seq");
+
+static constexpr uint8_t kMaxRecords = 32;
+static constexpr uint8_t kMaxActivity = 100;
+static constexpr uint8_t kMaxClass = 3;
+static constexpr uint32_t kMaxGapS = 0xFFFFFFFFUL >> 2;
+
+// Duty cycle the tag's battery policy has it running at; higher tiers sleep
+// longer, sample shorter and batch more (sensor_tag/include/power_policy.h).
+enum class PowerTier : uint8_t {
+  kNormal,
+  kSaver,
+  kCritical,
+};
+static constexpr uint8_t kMaxPowerTier = static_cast<uint8_t>(PowerTier::kCritical);
+
+// Cadence of each tier against kNormal: its deep-sleep timers are `sleep`
+// times longer and it batches `batch` times as many wakes per transmission.
+// The tag runs its tiers from this table and the display expects its tags'
+// silences from it.
+struct TierScale {
+  uint32_t sleep;
+  uint32_t batch;
+};
+
+constexpr TierScale tierScale(PowerTier tier) {
+  return tier == PowerTier::kCritical ? TierScale{8, 4}
+         : tier == PowerTier::kSaver  ? TierScale{2, 2}
+                                      : TierScale{1, 1};
+}
+
+// How many times longer than in kNormal a tag in `tier` can go without
+// transmitting.
+constexpr uint32_t tierQuietScale(PowerTier tier) { return tierScale(tier).sleep * tierScale(tier).batch; }
+
+// Worst case before any record: the prefix, a 32-bit age, a 16-bit battery
+// varint, the tier and the boot epoch. The first record has no gap, so it is
+// always 2 bytes.
+static constexpr size_t kMaxBatchOverhead =
+    sizeof(ActivityBatchPrefix) + varintSize(0xFFFFFFFFUL) + varintSize(0xFFFF) + 2;
+static constexpr size_t kFirstRecordSize = 1 + varintSize(kMaxClass);
+static_assert(kMaxBatchOverhead + kFirstRecordSize <= kMinFrameLen,
+              "every frame must carry at least one record");
+
+// One decoded record.
+struct ActivityRecord {
+  uint32_t seq;
+  uint32_t age_s;
+  uint16_t battery_mv;
+  uint8_t activity;
+  uint8_t activity_class;
+  uint8_t power_tier;  // PowerTier
+  uint8_t boot_epoch;
+};
+
+// Encodes a batch into a caller-provided frame buffer. Feed records oldest
+// first; add() refuses a record once the frame is full (or on bad input),
+// and the caller sends the rest in another frame.
+class ActivityBatchWriter {
+ public:
+  ActivityBatchWriter(uint8_t* buf, size_t cap) : buf_(buf), end_(buf + cap) {}
+
+  // Starts a frame whose first record has `firstSeq` and `firstAgeS`.
+  bool begin(uint32_t firstSeq, uint32_t firstAgeS, uint16_t batteryMv, PowerTier tier, uint8_t bootEpoch);
+
+  // Appends the next record (sequence number first_seq + size()).
+  bool add(uint8_t activity, uint8_t activityClass, uint32_t ageS);
+
+  uint8_t size() const { return count_; }
+
+  // Patches the record count; returns the frame length (0 if empty).
+  size_t finish();
+
+ private:
+  uint8_t* buf_;
+  const uint8_t* end_;
+  uint8_t* cursor_ = nullptr;
+  uint8_t count_ = 0;
+  uint32_t last_age_s_ = 0;
+};
+
+// Zero-copy view of a received frame: validates the header and prefix up
+// front and decodes records straight out of the caller's buffer, which must
+// outlive the view. Nothing is copied into intermediate structs.
+class ActivityBatchView {
+ public:
+  ActivityBatchView(const uint8_t* data, size_t len);
+
+  // False for a truncated frame, another message type or another version.
+  bool valid() const { return records_ != nullptr; }
+  uint8_t version() const { return len_ > 0 ? headerVersion(data_[0]) : 0; }
+
+  uint32_t firstSeq() const {
+    uint32_t seq;
+    memcpy(&seq, data_ + offsetof(ActivityBatchPrefix, first_seq), sizeof(seq));
+    return seq;
+  }
+  uint8_t count() const { return data_[offsetof(ActivityBatchPrefix, count)]; }
+  uint16_t batteryMv() const { return battery_mv_; }
+  PowerTier powerTier() const { return static_cast<PowerTier>(power_tier_); }
+  uint8_t bootEpoch() const { return boot_epoch_; }
+
+  // Walks the records in order; next() returns false after the last one or
+  // if a record is malformed.
+  class Iterator {
+   public:
+    bool next(ActivityRecord& out);
+
+   private:
+    friend class ActivityBatchView;
+    Iterator(const ActivityBatchView& view, const uint8_t* pos)
+        : view_(view), pos_(pos), age_s_(view.first_age_s_) {}
+
+    const ActivityBatchView& view_;
+    const uint8_t* pos_;
+    uint32_t age_s_;
+    uint8_t index_ = 0;
+  };
+
+  Iterator records() const { return Iterator(*this, records_); }
+
+ private:
+  const uint8_t* data_;
+  size_t len_;
+  const uint8_t* records_ = nullptr;
+  uint32_t first_age_s_ = 0;
+  uint16_t battery_mv_ = 0;
+  uint8_t power_tier_ = 0;
+  uint8_t boot_epoch_ = 0;
+};
+
+}  // namespace protocol
+
+#endif
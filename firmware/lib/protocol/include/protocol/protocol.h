@@ -0,0 +1,49 @@
+#ifndef PROTOCOL_PROTOCOL_H
+#define PROTOCOL_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Wire protocol shared by the sensor tag and the display. Every frame (GATT
+// notification or advert manufacturer data) starts with one header byte:
+// the protocol version in the high nibble and the message type in the low
+// nibble. Receivers drop frames whose version they do not speak.
+
+namespace protocol {
+
+static constexpr uint8_t kVersion = 3;
+
+enum class MessageType : uint8_t {
+  kActivityBatch = 1,
+};
+
+constexpr uint8_t headerByte(MessageType type) {
+  return static_cast<uint8_t>((kVersion << 4) | (static_cast<uint8_t>(type) & 0x0F));
+}
+
+constexpr uint8_t headerVersion(uint8_t header) { return static_cast<uint8_t>(header >> 4); }
+
+constexpr MessageType headerType(uint8_t header) { return static_cast<MessageType>(header & 0x0F); }
+
+// Smallest frame a transport may offer: a notification at the default MTU.
+// Every message must fit at least one record in it.
+static constexpr size_t kMinFrameLen = 20;
+
+// ---- Unsigned LEB128 varints ----
+
+// Bytes needed for `v`.
+constexpr size_t varintSize(uint32_t v) {
+  return v < (1UL << 7) ? 1 : v < (1UL << 14) ? 2 : v < (1UL << 21) ? 3 : v < (1UL << 28) ? 4 : 5;
+}
+
+// Writes `v` at `out` if it fits before `end`; returns the byte after it, or
+// nullptr when it does not fit.
+uint8_t* putVarint(uint8_t* out, const uint8_t* end, uint32_t v);
+
+// Reads a varint at `in`, stopping at `end`; returns the byte after it, or
+// nullptr on truncation or a value wider than 32 bits.
+const uint8_t* getVarint(const uint8_t* in, const uint8_t* end, uint32_t& v);
+
+}  // namespace protocol
+
+#endif
@@ -0,0 +1,108 @@
+#include "protocol/activity_batch.h"
+
+namespace protocol {
+
+bool ActivityBatchWriter::begin(uint32_t firstSeq, uint32_t firstAgeS, uint16_t batteryMv, PowerTier tier,
+                                uint8_t bootEpoch) {
+  count_ = 0;
+  cursor_ = nullptr;
+  if (static_cast<size_t>(end_ - buf_) < sizeof(ActivityBatchPrefix)) {
+    return false;
+  }
+  ActivityBatchPrefix prefix;
+  prefix.header = headerByte(MessageType::kActivityBatch);
+  prefix.first_seq = firstSeq;
+  prefix.count = 0;
+  memcpy(buf_, &prefix, sizeof(prefix));
+
+  uint8_t* p = putVarint(buf_ + sizeof(prefix), end_, firstAgeS);
+  p = putVarint(p, end_, batteryMv);
+  if (p != nullptr && end_ - p >= 2) {
+    *p++ = static_cast<uint8_t>(tier);
+    *p++ = bootEpoch;
+  } else {
+    p = nullptr;
+  }
+  cursor_ = p;
+  last_age_s_ = firstAgeS;
+  return cursor_ != nullptr;
+}
+
+bool ActivityBatchWriter::add(uint8_t activity, uint8_t activityClass, uint32_t ageS) {
+  if (cursor_ == nullptr || count_ >= kMaxRecords || activity > kMaxActivity || activityClass > kMaxClass ||
+      ageS > last_age_s_ || last_age_s_ - ageS > kMaxGapS) {
+    return false;
+  }
+  const uint32_t gap_class = ((last_age_s_ - ageS) << 2) | activityClass;
+  if (static_cast<size_t>(end_ - cursor_) < 1 + varintSize(gap_class)) {
+    return false;
+  }
+  *cursor_++ = activity;
+  cursor_ = putVarint(cursor_, end_, gap_class);
+  last_age_s_ = ageS;
+  ++count_;
+  return true;
+}
+
+size_t ActivityBatchWriter::finish() {
+  if (cursor_ == nullptr || count_ == 0) {
+    return 0;
+  }
+  buf_[offsetof(ActivityBatchPrefix, count)] = count_;
+  return static_cast<size_t>(cursor_ - buf_);
+}
+
+// ---- ActivityBatchView ----
+
+ActivityBatchView::ActivityBatchView(const uint8_t* data, size_t len) : data_(data), len_(len) {
+  if (data == nullptr || len < sizeof(ActivityBatchPrefix) || headerVersion(data[0]) != kVersion ||
+      headerType(data[0]) != MessageType::kActivityBatch) {
+    return;
+  }
+  const uint8_t count = data[offsetof(ActivityBatchPrefix, count)];
+  if (count == 0 || count > kMaxRecords) {
+    return;
+  }
+  const uint8_t* end = data + len;
+  uint32_t battery = 0;
+  const uint8_t* p = getVarint(data + sizeof(ActivityBatchPrefix), end, first_age_s_);
+  p = getVarint(p, end, battery);
+  if (p == nullptr || battery > 0xFFFF || end - p < 2 || *p > kMaxPowerTier) {
+    return;
+  }
+  battery_mv_ = static_cast<uint16_t>(battery);
+  power_tier_ = *p++;
+  boot_epoch_ = *p++;
+  records_ = p;
+}
+
+bool ActivityBatchView::Iterator::next(ActivityRecord& out) {
+  if (pos_ == nullptr || index_ >= view_.count()) {
+    return false;
+  }
+  const uint8_t* end = view_.data_ + view_.len_;
+  if (pos_ >= end) {
+    pos_ = nullptr;
+    return false;
+  }
+  const uint8_t activity = *pos_++;
+  uint32_t gap_class = 0;
+  pos_ = getVarint(pos_, end, gap_class);
+  const uint32_t gap = gap_class >> 2;
+  if (pos_ == nullptr || activity > kMaxActivity || gap > age_s_) {
+    pos_ = nullptr;
+    return false;
+  }
+  age_s_ -= gap;
+  out.seq = view_.firstSeq() + index_;
+  out.age_s = age_s_;
+  out.battery_mv = view_.battery_mv_;
+  out.power_tier = view_.power_tier_;
+  out.boot_epoch = view_.boot_epoch_;
+  out.activity = activity;
+  out.activity_class = static_cast<uint8_t>(gap_class & 0x03);
+  ++index_;
+  return true;
+}
+
+}  // namespace protocol
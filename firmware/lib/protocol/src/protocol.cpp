@@ -0,0 +1,32 @@
+#include "protocol/protocol.h"
+
+namespace protocol {
+
+uint8_t* putVarint(uint8_t* out, const uint8_t* end, uint32_t v) {
+  if (out == nullptr || static_cast<size_t>(end - out) < varintSize(v)) {
+    return nullptr;
+  }
+  while (v >= 0x80) {
+    *out++ = static_cast<uint8_t>(v | 0x80);
+    v >>= 7;
+  }
+  *out++ = static_cast<uint8_t>(v);
+  return out;
+}
+
+const uint8_t* getVarint(const uint8_t* in, const uint8_t* end, uint32_t& v) {
+  v = 0;
+  for (uint8_t shift = 0; shift < 35 && in != nullptr && in < end; shift += 7) {
+    const uint8_t byte = *in++;
+    if (shift == 28 && (byte & 0xF0) != 0) {
+      return nullptr;
+    }
+    v |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return in;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace protocol
@@ -0,0 +1,52 @@
+#ifndef TRACE_TRACE_H
+#define TRACE_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Stage tracer behind LOG_STAGE. Every mark() closes the running stage,
+// folds its duration into per-stage min/avg/max aggregates and appends a
+// timestamped event to a fixed ring. All of it lives in RTC memory, so
+// on the tag it survives deep sleep; stage names are stored as pointers to
+// string literals, which stay valid across wakes of the same image.
+//
+// dump() writes one line, "TRACE1 <hex>", decoded by tools/trace_decode.py.
+
+namespace trace {
+
+static constexpr size_t kEventCapacity = 128;
+static constexpr size_t kMaxStages = 16;
+
+struct Event {
+  uint32_t t_us;  // hal::clock::micros() at the mark
+  uint8_t stage;  // index into the stage table
+  uint8_t wake;   // low byte of the wake counter
+  uint16_t reserved;
+};
+
+struct StageStats {
+  const char* name;
+  uint32_t count;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint64_t sum_us;
+};
+
+// Starts a new wake: validates (or initialises) the retained state, bumps
+// the wake counter and drops the stage left open by the previous wake, whose
+// timestamps no longer compare with this one's.
+void beginWake();
+
+// Closes the running stage and opens `name`. `name` must be a string literal.
+void mark(const char* name);
+
+uint32_t wakes();
+size_t stageCount();
+const StageStats& stage(size_t index);
+
+void dump();
+void reset();
+
+}  // namespace trace
+
+#endif
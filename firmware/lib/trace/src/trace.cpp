@@ -0,0 +1,160 @@
+#include "trace/trace.h"
+
+#include <string.h>
+
+#include "hal/clock.h"
+#include "hal/console.h"
+#include "hal/sleep.h"
+
+namespace trace {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x54524331;  // "TRC1"
+constexpr uint8_t kNoStage = 0xFF;
+constexpr uint8_t kDumpVersion = 1;
+
+struct State {
+  uint32_t magic;
+  uint32_t wakes;
+  uint16_t head;
+  uint16_t count;
+  uint8_t stage_count;
+  uint8_t open_stage;
+  uint32_t open_start_us;
+  Event events[kEventCapacity];
+  StageStats stages[kMaxStages];
+};
+
+HAL_RTC_DATA State g_state;
+
+uint8_t stageIndex(const char* name) {
+  for (uint8_t i = 0; i < g_state.stage_count; ++i) {
+    const char* known = g_state.stages[i].name;
+    if (known == name || strcmp(known, name) == 0) {
+      return i;
+    }
+  }
+  if (g_state.stage_count >= kMaxStages) {
+    return kNoStage;
+  }
+  StageStats& s = g_state.stages[g_state.stage_count];
+  s.name = name;
+  s.count = 0;
+  s.min_us = UINT32_MAX;
+  s.max_us = 0;
+  s.sum_us = 0;
+  return g_state.stage_count++;
+}
+
+void closeOpenStage(uint32_t now_us) {
+  if (g_state.open_stage == kNoStage) {
+    return;
+  }
+  StageStats& s = g_state.stages[g_state.open_stage];
+  const uint32_t dur = now_us - g_state.open_start_us;
+  ++s.count;
+  s.sum_us += dur;
+  if (dur < s.min_us) {
+    s.min_us = dur;
+  }
+  if (dur > s.max_us) {
+    s.max_us = dur;
+  }
+}
+
+void appendEvent(uint32_t now_us, uint8_t stage) {
+  Event& e = g_state.events[g_state.head];
+  e.t_us = now_us;
+  e.stage = stage;
+  e.wake = static_cast<uint8_t>(g_state.wakes);
+  e.reserved = 0;
+  g_state.head = static_cast<uint16_t>((g_state.head + 1) % kEventCapacity);
+  if (g_state.count < kEventCapacity) {
+    ++g_state.count;
+  }
+}
+
+// Hex writer for the dump line, little-endian like the in-memory layout.
+void putByte(uint8_t b) {
+  static const char kDigits[] = "0123456789abcdef";
+  Serial.print(kDigits[b >> 4]);
+  Serial.print(kDigits[b & 0x0F]);
+}
+
+void putLe(uint64_t v, size_t bytes) {
+  for (size_t i = 0; i < bytes; ++i) {
+    putByte(static_cast<uint8_t>(v >> (8 * i)));
+  }
+}
+
+}  // namespace
+
+void reset() {
+  memset(&g_state, 0, sizeof(g_state));
+  g_state.magic = kMagic;
+  g_state.open_stage = kNoStage;
+}
+
+void beginWake() {
+  if (g_state.magic != kMagic) {
+    reset();
+  }
+  ++g_state.wakes;
+  g_state.open_stage = kNoStage;
+}
+
+void mark(const char* name) {
+  if (g_state.magic != kMagic) {
+    reset();
+  }
+  const uint32_t now_us = hal::clock::micros();
+  closeOpenStage(now_us);
+
+  const uint8_t stage = stageIndex(name);
+  g_state.open_stage = stage;
+  g_state.open_start_us = now_us;
+  if (stage != kNoStage) {
+    appendEvent(now_us, stage);
+  }
+}
+
+uint32_t wakes() { return g_state.wakes; }
+size_t stageCount() { return g_state.stage_count; }
+const StageStats& stage(size_t index) { return g_state.stages[index]; }
+
+// Layout: version u8, wakes u32, stage_count u8, event_count u16, then per
+// stage {name_len u8, name, count u32, min_us u32, max_us u32, sum_us u64},
+// then events oldest first {t_us u32, stage u8, wake u8}.
+void dump() {
+  Serial.print("TRACE1 ");
+  putLe(kDumpVersion, 1);
+  putLe(g_state.wakes, 4);
+  putLe(g_state.stage_count, 1);
+  putLe(g_state.count, 2);
+
+  for (uint8_t i = 0; i < g_state.stage_count; ++i) {
+    const StageStats& s = g_state.stages[i];
+    const size_t len = strlen(s.name) > 255 ? 255 : strlen(s.name);
+    putLe(len, 1);
+    for (size_t c = 0; c < len; ++c) {
+      putByte(static_cast<uint8_t>(s.name[c]));
+    }
+    putLe(s.count, 4);
+    putLe(s.count == 0 ? 0 : s.min_us, 4);
+    putLe(s.max_us, 4);
+    putLe(s.sum_us, 8);
+  }
+
+  const uint16_t start =
+      static_cast<uint16_t>((g_state.head + kEventCapacity - g_state.count) % kEventCapacity);
+  for (uint16_t i = 0; i < g_state.count; ++i) {
+    const Event& e = g_state.events[(start + i) % kEventCapacity];
+    putLe(e.t_us, 4);
+    putLe(e.stage, 1);
+    putLe(e.wake, 1);
+  }
+  Serial.println();
+}
+
+}  // namespace trace
@@ -1,24 +1,26 @@
 #ifndef SENSOR_ACTIVITY_ALGO_H
 #define SENSOR_ACTIVITY_ALGO_H
 
-#include <Arduino.h>
+#include <stdint.h>
 
 namespace activity {
 
-inline uint16_t clampToPercent(float value) {
-  if (value < 0.0f) {
-    return 0;
-  }
-  if (value > 100.0f) {
-    return 100;
-  }
-  return static_cast<uint16_t>(value + 0.5f);
+// Score from the gravity-free signal magnitude area (Features::sma, in LSB):
+// 0 g -> 0, kSmaFullScaleMicroG -> 100, clamped, so a motionless tag scores
+// 0. Integer only for the FPU-less ESP32-C3; tools/score_check.cpp checks it
+// against the float rule to within 1 point.
+static constexpr uint32_t kSmaFullScaleMicroG = 1500000;
+static constexpr uint32_t kSmaMicroGPerPoint = kSmaFullScaleMicroG / 100;
+
+inline uint16_t computeActivityFromSma(uint32_t smaLsb, uint32_t microGPerLsb) {
+  const uint32_t score = (smaLsb * microGPerLsb + kSmaMicroGPerPoint / 2) / kSmaMicroGPerPoint;
+  return static_cast<uint16_t>(score > 100 ? 100 : score);
 }
 
-inline uint16_t computeActivityFromAverage(float avgSumAbs) {
-  // Simple linear scale: 0g -> 0, 3g total movement -> 100.
-  const float scaled = (avgSumAbs / 3.0f) * 100.0f;
-  return clampToPercent(scaled);
+// Change in the window SMA, in LSB, that moves computeActivityFromSma() by
+// `points`.
+constexpr uint32_t smaLsbForPoints(uint32_t points, uint32_t microGPerLsb) {
+  return points * kSmaMicroGPerPoint / microGPerLsb;
 }
 
 }  // namespace activity
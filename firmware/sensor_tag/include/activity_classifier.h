@@ -0,0 +1,75 @@
+#ifndef SENSOR_ACTIVITY_CLASSIFIER_H
+#define SENSOR_ACTIVITY_CLASSIFIER_H
+
+#include <stdint.h>
+
+#include "activity_features.h"
+#include "activity_model.h"
+#include "imu_lsm6ds3.h"
+
+namespace activity {
+
+// Class labels; the values are part of the BLE payload.
+enum class ActivityClass : uint8_t {
+  kResting = 0,
+  kWalking = 1,
+  kHighActivity = 2,
+};
+
+inline const char* className(ActivityClass c) {
+  switch (c) {
+    case ActivityClass::kResting:
+      return "resting";
+    case ActivityClass::kWalking:
+      return "walking";
+    case ActivityClass::kHighActivity:
+      return "high";
+  }
+  return "?";
+}
+
+// Features field by model feature index; the order is fixed by
+// tools/train_classifier.py (FEATURES).
+inline uint32_t featureValue(const Features& f, uint8_t index) {
+  switch (index) {
+    case 0:
+      return f.sma;
+    case 1:
+      return f.vm_mean;
+    case 2:
+      return f.p2p;
+    case 3:
+      return f.zcr_hz_q4;
+    default:
+      return f.energy;
+  }
+}
+
+// Compile-time check that every path from `node` reaches a leaf within
+// `depth` steps and every index and label is in range.
+constexpr bool subtreeValid(uint8_t node, uint8_t depth) {
+  return node < model::kNodeCount &&
+         (model::kFeature[node] == model::kLeaf
+              ? model::kLeft[node] <= static_cast<uint8_t>(ActivityClass::kHighActivity)
+              : depth > 0 && model::kFeature[node] <= 4 && subtreeValid(model::kLeft[node], depth - 1) &&
+                    subtreeValid(model::kRight[node], depth - 1));
+}
+
+static_assert(subtreeValid(0, model::kMaxDepth), "malformed activity_model.h");
+static_assert(model::kMicroGPerLsb == imu::kMicroGPerLsb,
+              "activity_model.h was trained at a different accelerometer full scale");
+
+// Walks the generated decision tree: at most model::kMaxDepth integer
+// compares, no float and no heap.
+inline ActivityClass classify(const Features& f) {
+  uint8_t node = 0;
+  while (model::kFeature[node] != model::kLeaf) {
+    node = featureValue(f, model::kFeature[node]) <= model::kThreshold[node] ? model::kLeft[node]
+                                                                              : model::kRight[node];
+  }
+  return static_cast<ActivityClass>(model::kLeft[node]);
+}
+
+}  // namespace activity
+
+#endif
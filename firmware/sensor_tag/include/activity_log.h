@@ -0,0 +1,48 @@
+#ifndef SENSOR_ACTIVITY_LOG_H
+#define SENSOR_ACTIVITY_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace activity_log {
+
+struct Record {
+  uint32_t seq;
+  uint32_t time_s;  // hal::clock::rtcSeconds() when the window was scored
+  uint16_t activity;
+  uint16_t battery_mv;
+  uint8_t activity_class;
+  uint8_t power_tier;  // protocol::PowerTier the window was taken in
+};
+
+// Ring of records waiting to be transmitted. It has no constructor so an
+// instance placed in RTC memory (HAL_RTC_DATA) is zeroed on power-on only and
+// keeps its contents across deep sleep. When full, push() overwrites the
+// oldest record.
+template <size_t N>
+struct Ring {
+  Record records[N];
+  uint16_t head;   // slot the next push() writes
+  uint16_t count;  // pending records, oldest at head - count
+
+  static constexpr size_t capacity() { return N; }
+  bool full() const { return count == N; }
+
+  void push(const Record& r) {
+    records[head] = r;
+    head = static_cast<uint16_t>((head + 1) % N);
+    if (count < N) {
+      ++count;
+    }
+  }
+
+  // i-th oldest pending record.
+  const Record& at(size_t i) const { return records[(head + N - count + i) % N]; }
+
+  // Drops the `n` oldest pending records.
+  void drop(size_t n) { count = static_cast<uint16_t>(n >= count ? 0 : count - n); }
+};
+
+}  // namespace activity_log
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef SENSOR_ACTIVITY_WINDOW_H
+#define SENSOR_ACTIVITY_WINDOW_H
+
+#include <stdint.h>
+
+#include "activity_algo.h"
+#include "activity_classifier.h"
+#include "activity_features.h"
+#include "config.h"
+#include "imu_lsm6ds3.h"
+#include "running_stats.h"
+
+namespace activity {
+
+// Window parameters derived from config.h.
+namespace window {
+
+constexpr imu::Odr kOdr = imu::odrFromHz(kImuOdrHz);
+static_assert(model::kOdrHz == imu::odrHz(kOdr), "activity_model.h was trained at a different IMU rate");
+
+// FIFO samples available `ms` into a window.
+constexpr uint16_t samplesAtMs(uint32_t ms) { return imu::fifoSamplesForWindow(kOdr, ms); }
+
+constexpr uint16_t kMaxSamples = samplesAtMs(kImuSampleWindowMs);
+static_assert(kMaxSamples > 0 && kMaxSamples <= imu::kFifoMaxSamples,
+              "IMU window does not fit in the LSM6DS3 FIFO");
+constexpr uint16_t kMinSamples = samplesAtMs(kImuMinWindowMs);
+static_assert(kMinSamples >= 2 && kImuMinWindowMs <= kImuSampleWindowMs,
+              "minimum IMU window must hold 2+ samples and fit in the window");
+
+constexpr uint32_t kToleranceLsb = smaLsbForPoints(kActivityTolerancePoints, imu::kMicroGPerLsb);
+static_assert(kToleranceLsb > 0 && kToleranceLsb <= 0xFFFF, "activity tolerance out of range");
+
+constexpr uint16_t kZcrDeadbandLsb = static_cast<uint16_t>(kZcrDeadbandMg * 1000UL / imu::kMicroGPerLsb);
+
+// Slope the LSM6DS3 wake-up logic triggers on, after WAKE_UP_THS rounding.
+constexpr uint32_t kWakeThresholdLsb = imu::wakeUpThs(kWakeThresholdMg, imu::kFullScale) * (32768UL / 64UL);
+
+}  // namespace window
+
+// Per-sample processing of one IMU window: the feature kernel, running
+// statistics of the per-sample score input for early termination, and the
+// largest slope for the motion check. The tag and tools/replay_trace.cpp
+// both use it, so offline evaluation runs the same code as the firmware.
+class WindowProcessor {
+ public:
+  void begin() {
+    kernel_.begin(imu::odrHz(window::kOdr), window::kZcrDeadbandLsb);
+    stats_.reset();
+    max_slope_lsb_ = 0;
+  }
+
+  void add(const imu::Sample& s) {
+    if (stats_.count() > 0) {
+      const uint32_t slope = imu::maxSlope(prev_, s);
+      max_slope_lsb_ = slope > max_slope_lsb_ ? slope : max_slope_lsb_;
+    }
+    stats_.add(kernel_.add(s));
+    prev_ = s;
+  }
+
+  uint32_t count() const { return stats_.count(); }
+
+  // True once the kActivityConfidenceZ-sigma confidence interval of the
+  // window SMA is within kActivityTolerancePoints.
+  bool settled() const {
+    return stats_.meanWithin(static_cast<uint16_t>(window::kToleranceLsb), kActivityConfidenceZ);
+  }
+
+  // Whether any slope (a[n] - a[n-1]) / 2 in the window exceeded the
+  // threshold the LSM6DS3 wake-up interrupt uses.
+  bool motion() const { return max_slope_lsb_ > window::kWakeThresholdLsb; }
+
+  Features features() const { return kernel_.finish(); }
+
+ private:
+  FeatureKernel kernel_;
+  stats::RunningStats stats_;
+  imu::Sample prev_ = {0, 0, 0};
+  uint32_t max_slope_lsb_ = 0;
+};
+
+struct WindowResult {
+  Features features;
+  uint16_t activity;
+  ActivityClass activity_class;
+};
+
+// What PROCESS derives from a finished window.
+inline WindowResult scoreWindow(const WindowProcessor& w) {
+  WindowResult r;
+  r.features = w.features();
+  r.activity = computeActivityFromSma(r.features.sma, imu::kMicroGPerLsb);
+  r.activity_class = classify(r.features);
+  return r;
+}
+
+}  // namespace activity
+
+#endif
@@ -1,19 +1,97 @@
 #ifndef SENSOR_CONFIG_H
 #define SENSOR_CONFIG_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 static constexpr const char* kBleDeviceName = "TECHIN514_SENSOR";
 static constexpr const char* kBleServiceUuid = "6f7f0001-8f3b-4c3a-a39a-3f8ec4dca101";
 static constexpr const char* kBleCharUuid = "6f7f0002-8f3b-4c3a-a39a-3f8ec4dca101";
 
+// kGatt: connect + notify. kAdvertising: broadcast the payload in adverts
+// (no connection). Tag and display must agree.
+enum class BleTransport : uint8_t {
+  kGatt,
+  kAdvertising,
+};
+static constexpr BleTransport kBleTransport = BleTransport::kAdvertising;
+
+// 0xFFFF is the Bluetooth SIG company ID reserved for internal/test use.
+static constexpr uint16_t kBleAdvCompanyId = 0xFFFF;
+
+// Connectionless transport: the payload rides in manufacturer-specific
+// advert data, repeated every kBleAdvIntervalMs for kBleAdvBurstMs.
+static constexpr uint16_t kBleAdvIntervalMs = 20;
+static constexpr uint32_t kBleAdvBurstMs = 60;
+
+// Longest IMU window. Sampling stops early once, after at least
+// kImuMinWindowMs and then every kImuCheckIntervalMs, the kActivityConfidenceZ
+// sigma confidence interval of the activity score is within
+// +/-kActivityTolerancePoints. A still pet settles at the minimum.
 static constexpr uint32_t kImuSampleWindowMs = 1500;
-static constexpr uint32_t kImuSamplePeriodMs = 40;
+static constexpr uint32_t kImuMinWindowMs = 400;
+static constexpr uint32_t kImuCheckIntervalMs = 200;
+static constexpr uint32_t kActivityTolerancePoints = 1;
+static constexpr uint32_t kActivityConfidenceZ = 2;
+// Dynamic acceleration must swing past +/-kZcrDeadbandMg for a zero crossing
+// to count, keeping sensor noise out of the zero-crossing rate.
+static constexpr uint32_t kZcrDeadbandMg = 50;
+// The LSM6DS3 FIFO collects the window on its own at this rate (rounded up to
+// a supported ODR) while the MCU light-sleeps.
+static constexpr uint32_t kImuOdrHz = 26;
+static constexpr uint32_t kImuFifoSlackMs = 100;
 static constexpr uint8_t kImuInitRetries = 3;
 
 static constexpr uint32_t kBleConnectTimeoutMs = 5000;
 static constexpr uint32_t kBlePostNotifyDelayMs = 120;
 
+// Adaptive deep sleep. The timer starts at kDeepSleepSeconds, doubles after
+// every still window up to kDeepSleepMaxSeconds and snaps back on motion.
+// While backed off, the LSM6DS3 wake-up interrupt (slope above
+// kWakeThresholdMg for more than kWakeDurationSamples samples at kImuOdrHz)
+// ends the sleep as soon as the pet moves. The threshold is the LSM6DS3
+// floor, one FS/64 step (31 mg at +/-2 g): a walking gait at 26 Hz rarely
+// has a steeper sample-to-sample slope, while a resting pet stays below it.
 static constexpr uint32_t kDeepSleepSeconds = 30;
+static constexpr uint32_t kDeepSleepMaxSeconds = 960;
+static constexpr uint32_t kWakeThresholdMg = 31;
+static constexpr uint8_t kWakeDurationSamples = 1;
+
+// Store-and-forward: scored windows queue up in RTC memory and the radio only
+// comes on once kBatchEveryWakes are pending (or the queue is full, e.g.
+// after failed GATT deliveries). At the usual 30 s spacing a record costs
+// two bytes on the wire (lib/protocol), so four fit in one advert or
+// notification with room to spare; longer gaps spill into a second frame.
+static constexpr size_t kBatchCapacity = 32;
+static constexpr uint32_t kBatchEveryWakes = 4;
+
+// Battery-aware duty cycle (power_policy.h). The battery reaches
+// PIN_BATTERY_ADC through a kBatteryDividerRatio:1 divider and is read as
+// kBatteryAdcSamples calibrated samples, the highest and lowest dropped,
+// then smoothed across wakes (1/2^kBatteryFilterShift per reading).
+// Below kTierSaverMv the tag moves to the saver tier and below
+// kTierCriticalMv to the critical tier; it only moves back up once the
+// battery is kTierHysteresisMv above the threshold, so load sag and a
+// charger's first minutes do not make it flap. Each tier multiplies both
+// deep-sleep timers and kBatchEveryWakes by its protocol::tierScale() (shared
+// with the display) and caps the IMU window.
+static constexpr uint8_t kBatteryAdcSamples = 16;
+static constexpr uint32_t kBatteryDividerRatio = 2;
+static constexpr uint8_t kBatteryFilterShift = 2;
+static constexpr uint16_t kTierSaverMv = 3600;
+static constexpr uint16_t kTierCriticalMv = 3450;
+static constexpr uint16_t kTierHysteresisMv = 60;
+static constexpr uint32_t kSaverWindowMs = 1000;
+static constexpr uint32_t kCriticalWindowMs = kImuMinWindowMs;
+
+// Recorder mode: instead of the sense/transmit cycle the tag streams raw FIFO
+// samples over Serial as an IMU trace for tools/replay_trace.cpp, draining
+// every kRecorderPollMs. Send r / w / h over Serial to label what the pet is
+// doing from then on, - to clear the label.
+static constexpr bool kImuRecorderMode = false;
+static constexpr uint32_t kRecorderPollMs = 250;
+
+// Also dump the stage trace every N wakes (0 = only when 'T' is received).
+static constexpr uint32_t kTraceDumpEveryWakes = 20;
 
 #endif
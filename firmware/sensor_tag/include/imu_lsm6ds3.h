@@ -1,21 +1,136 @@
 #ifndef SENSOR_IMU_LSM6DS3_H
 #define SENSOR_IMU_LSM6DS3_H
 
-#include <Arduino.h>
-#include <Wire.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal/i2c.h"
 #include "pins.h"
 
 namespace imu {
 
+// Raw accelerometer output in LSB; scale with kMicroGPerLsb.
 struct Sample {
-  float ax_g;
-  float ay_g;
-  float az_g;
+  int16_t x;
+  int16_t y;
+  int16_t z;
 };
 
+static constexpr uint8_t kRegFifoCtrl1 = 0x06;
+static constexpr uint8_t kRegFifoCtrl2 = 0x07;
+static constexpr uint8_t kRegFifoCtrl3 = 0x08;
+static constexpr uint8_t kRegFifoCtrl5 = 0x0A;
 static constexpr uint8_t kRegWhoAmI = 0x0F;
 static constexpr uint8_t kRegCtrl1Xl = 0x10;
+static constexpr uint8_t kRegCtrl6C = 0x15;
+static constexpr uint8_t kRegWakeUpSrc = 0x1B;
 static constexpr uint8_t kRegOutXL = 0x28;
+static constexpr uint8_t kRegFifoStatus1 = 0x3A;
+static constexpr uint8_t kRegFifoStatus2 = 0x3B;
+static constexpr uint8_t kRegFifoDataOutL = 0x3E;
+static constexpr uint8_t kRegTapCfg = 0x58;
+static constexpr uint8_t kRegWakeUpThs = 0x5B;
+static constexpr uint8_t kRegWakeUpDur = 0x5C;
+static constexpr uint8_t kRegMd1Cfg = 0x5E;
+
+// WAKE_UP_SRC.WU_IA: a wake-up event is latched.
+static constexpr uint8_t kWakeUpSrcWuIa = 0x08;
+
+// FIFO holds 4096 16-bit words; with only the accelerometer enabled each
+// sample is one X/Y/Z triplet.
+static constexpr uint16_t kFifoWords = 4096;
+static constexpr uint16_t kFifoMaxSamples = kFifoWords / 3;
+
+// Accelerometer / FIFO output data rates. The same nibble encodes ODR_XL in
+// CTRL1_XL[7:4] and ODR_FIFO in FIFO_CTRL5[6:3].
+enum class Odr : uint8_t {
+  k26Hz = 0x2,
+  k52Hz = 0x3,
+  k104Hz = 0x4,
+  k208Hz = 0x5,
+  k416Hz = 0x6,
+};
+
+constexpr uint32_t odrHz(Odr odr) {
+  return odr == Odr::k26Hz    ? 26
+         : odr == Odr::k52Hz  ? 52
+         : odr == Odr::k104Hz ? 104
+         : odr == Odr::k208Hz ? 208
+                              : 416;
+}
+
+// FIFO_CTRL5[2:0] FIFO_MODE.
+enum class FifoMode : uint8_t {
+  kStopWhenFull = 0x1,
+  kContinuous = 0x6,
+};
+
+// Accelerometer full scale, encoded as CTRL1_XL[3:2].
+enum class FullScale : uint8_t {
+  k2g = 0x0,
+  k16g = 0x1,
+  k4g = 0x2,
+  k8g = 0x3,
+};
+
+// Datasheet sensitivity: 0.061 / 0.122 / 0.244 / 0.488 mg/LSB.
+constexpr uint32_t microGPerLsb(FullScale fs) {
+  return fs == FullScale::k2g   ? 61
+         : fs == FullScale::k4g ? 122
+         : fs == FullScale::k8g ? 244
+                                : 488;
+}
+
+static constexpr FullScale kFullScale = FullScale::k2g;
+static constexpr uint32_t kMicroGPerLsb = microGPerLsb(kFullScale);
+
+constexpr uint32_t fullScaleMg(FullScale fs) {
+  return fs == FullScale::k2g   ? 2000
+         : fs == FullScale::k4g ? 4000
+         : fs == FullScale::k8g ? 8000
+                                : 16000;
+}
+
+// Wake-up threshold steps of FS/64 covering `mg`, rounded up.
+constexpr uint32_t wakeUpSteps(uint32_t mg, FullScale fs) {
+  return (mg * 64 + fullScaleMg(fs) - 1) / fullScaleMg(fs);
+}
+
+// WAKE_UP_THS[5:0] for `mg`, kept in the usable range 1..63.
+constexpr uint8_t wakeUpThs(uint32_t mg, FullScale fs) {
+  return wakeUpSteps(mg, fs) < 1    ? 1
+         : wakeUpSteps(mg, fs) > 63 ? 63
+                                    : static_cast<uint8_t>(wakeUpSteps(mg, fs));
+}
+
+constexpr uint8_t ctrl1Xl(Odr odr, FullScale fs) {
+  return static_cast<uint8_t>((static_cast<uint8_t>(odr) << 4) | (static_cast<uint8_t>(fs) << 2));
+}
+
+// Largest per-axis slope (b - a) / 2 in LSB, as the wake-up logic sees it.
+inline uint32_t maxSlope(const Sample& a, const Sample& b) {
+  int32_t d[3] = {(b.x - a.x) / 2, (b.y - a.y) / 2, (b.z - a.z) / 2};
+  uint32_t m = 0;
+  for (int i = 0; i < 3; ++i) {
+    const uint32_t v = static_cast<uint32_t>(d[i] < 0 ? -d[i] : d[i]);
+    m = v > m ? v : m;
+  }
+  return m;
+}
+
+// Lowest supported rate that is at least `hz`.
+constexpr Odr odrFromHz(uint32_t hz) {
+  return hz <= 26    ? Odr::k26Hz
+         : hz <= 52  ? Odr::k52Hz
+         : hz <= 104 ? Odr::k104Hz
+         : hz <= 208 ? Odr::k208Hz
+                     : Odr::k416Hz;
+}
+
+// Samples the FIFO collects for a window of `windowMs` at `odr`.
+constexpr uint16_t fifoSamplesForWindow(Odr odr, uint32_t windowMs) {
+  return static_cast<uint16_t>((odrHz(odr) * windowMs) / 1000UL);
+}
 
 class Lsm6ds3 {
  public:
@@ -24,15 +139,19 @@ class Lsm6ds3 {
       return false;
     }
 
-    Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL);
-    Wire.setClock(400000);
+    if (!hal::i2c::begin(PIN_I2C_SDA, PIN_I2C_SCL, 400000)) {
+      return false;
+    }
 
     if (!probeAddress(0x6A) && !probeAddress(0x6B)) {
       return false;
     }
 
-    // ODR=416Hz, FS=+/-2g.
-    if (!writeReg(kRegCtrl1Xl, 0x60)) {
+    // High-performance mode; enableWakeOnMotion() switches to low power.
+    if (!writeReg(kRegCtrl6C, 0x00)) {
+      return false;
+    }
+    if (!writeReg(kRegCtrl1Xl, ctrl1Xl(Odr::k416Hz, kFullScale))) {
       return false;
     }
     return true;
@@ -43,20 +162,141 @@ class Lsm6ds3 {
     if (!readRegs(kRegOutXL, raw, sizeof(raw))) {
       return false;
     }
+    decodeSample(raw, out);
+    return true;
+  }
 
-    const int16_t x = static_cast<int16_t>((raw[1] << 8) | raw[0]);
-    const int16_t y = static_cast<int16_t>((raw[3] << 8) | raw[2]);
-    const int16_t z = static_cast<int16_t>((raw[5] << 8) | raw[4]);
+  // Restarts the accelerometer at `odr` and lets the FIFO collect samples on
+  // its own. In kStopWhenFull the FIFO stops filling once full, so the oldest
+  // samples of the window are the ones kept; kContinuous overwrites the
+  // oldest instead, for streaming. `watermarkSamples` sets
+  // FIFO_STATUS2.WaterM.
+  bool startFifo(Odr odr, uint16_t watermarkSamples, FifoMode mode = FifoMode::kStopWhenFull) {
+    if (watermarkSamples == 0 || watermarkSamples > kFifoMaxSamples) {
+      return false;
+    }
+    const uint16_t words = static_cast<uint16_t>(watermarkSamples * 3U);
+    const uint8_t odrBits = static_cast<uint8_t>(odr);
 
-    // LSM6DS3 +/-2g sensitivity: 0.061 mg/LSB.
-    static constexpr float kLsbToG = 0.000061f;
-    out.ax_g = x * kLsbToG;
-    out.ay_g = y * kLsbToG;
-    out.az_g = z * kLsbToG;
+    // Bypass mode empties the FIFO so the pattern restarts at X.
+    if (!writeReg(kRegFifoCtrl5, 0x00)) {
+      return false;
+    }
+    if (!writeReg(kRegFifoCtrl1, static_cast<uint8_t>(words & 0xFF)) ||
+        !writeReg(kRegFifoCtrl2, static_cast<uint8_t>((words >> 8) & 0x0F))) {
+      return false;
+    }
+    // Accelerometer in FIFO without decimation, gyroscope not stored.
+    if (!writeReg(kRegFifoCtrl3, 0x01)) {
+      return false;
+    }
+    if (!writeReg(kRegCtrl1Xl, ctrl1Xl(odr, kFullScale))) {
+      return false;
+    }
+    return writeReg(kRegFifoCtrl5, static_cast<uint8_t>((odrBits << 3) | static_cast<uint8_t>(mode)));
+  }
+
+  // Returns to bypass mode (discarding anything unread) and powers the
+  // accelerometer down until the next startFifo()/begin().
+  bool stopFifo() {
+    const bool bypass = writeReg(kRegFifoCtrl5, 0x00);
+    return writeReg(kRegCtrl1Xl, 0x00) && bypass;
+  }
+
+  // Leaves the accelerometer running at `odr` in low-power mode with the
+  // wake-up interrupt routed to INT1. INT1 latches high once the slope
+  // (a[n] - a[n-1]) / 2 of any axis exceeds `thresholdMg` for more than
+  // `durationSamples` (0-3) consecutive samples, and stays high until
+  // readWakeSource(). Any stale latch is cleared first.
+  bool enableWakeOnMotion(Odr odr, uint32_t thresholdMg, uint8_t durationSamples) {
+    if (!writeReg(kRegFifoCtrl5, 0x00) || !writeReg(kRegCtrl6C, 0x10) ||
+        !writeReg(kRegCtrl1Xl, ctrl1Xl(odr, kFullScale))) {
+      return false;
+    }
+    if (!writeReg(kRegWakeUpThs, wakeUpThs(thresholdMg, kFullScale)) ||
+        !writeReg(kRegWakeUpDur, static_cast<uint8_t>((durationSamples & 0x03) << 5))) {
+      return false;
+    }
+    // TAP_CFG: latched interrupts (LIR), slope filter (SLOPE_FDS = 0); the
+    // LSM6DS3 has no interrupt enable bit (bit 7 is TIMER_EN). Then INT1_WU.
+    if (!writeReg(kRegTapCfg, 0x01) || !writeReg(kRegMd1Cfg, 0x20)) {
+      return false;
+    }
+    readWakeSource();
     return true;
   }
 
+  bool disableWakeOnMotion() {
+    const bool routed = writeReg(kRegMd1Cfg, 0x00);
+    return writeReg(kRegTapCfg, 0x00) && routed;
+  }
+
+  // Returns WAKE_UP_SRC (0 on bus error); reading it releases a latched INT1.
+  uint8_t readWakeSource() {
+    uint8_t src = 0;
+    if (!readRegs(kRegWakeUpSrc, &src, 1)) {
+      return 0;
+    }
+    return src;
+  }
+
+  bool fifoWatermarkReached() {
+    uint8_t status2 = 0;
+    if (!readRegs(kRegFifoStatus2, &status2, 1)) {
+      return false;
+    }
+    return (status2 & 0x80) != 0;
+  }
+
+  // Number of complete X/Y/Z samples waiting in the FIFO.
+  uint16_t fifoSamplesAvailable() {
+    uint8_t status[2] = {0};
+    if (!readRegs(kRegFifoStatus1, status, sizeof(status))) {
+      return 0;
+    }
+    const uint16_t words = static_cast<uint16_t>(((status[1] & 0x0F) << 8) | status[0]);
+    return static_cast<uint16_t>(words / 3U);
+  }
+
+  // Drains up to `maxSamples` samples into `out` using burst reads of
+  // FIFO_DATA_OUT (the register address rolls back from 0x3F to 0x3E, so one
+  // transaction returns consecutive words). Returns the number of samples
+  // written.
+  size_t readFifo(Sample* out, size_t maxSamples) {
+    size_t remaining = fifoSamplesAvailable();
+    if (remaining > maxSamples) {
+      remaining = maxSamples;
+    }
+
+    size_t done = 0;
+    uint8_t raw[kFifoBurstSamples * 6];
+    while (done < remaining) {
+      size_t chunk = remaining - done;
+      if (chunk > kFifoBurstSamples) {
+        chunk = kFifoBurstSamples;
+      }
+      if (!readRegs(kRegFifoDataOutL, raw, chunk * 6)) {
+        break;
+      }
+      for (size_t i = 0; i < chunk; ++i) {
+        decodeSample(&raw[i * 6], out[done + i]);
+      }
+      done += chunk;
+    }
+    return done;
+  }
+
  private:
+  // Samples per I2C burst; 20 * 6 bytes fits one hal::i2c::kMaxReadLen read.
+  static constexpr size_t kFifoBurstSamples = 20;
+  static_assert(kFifoBurstSamples * 6 <= hal::i2c::kMaxReadLen, "FIFO burst exceeds I2C read limit");
+
+  static void decodeSample(const uint8_t* raw, Sample& out) {
+    out.x = static_cast<int16_t>((raw[1] << 8) | raw[0]);
+    out.y = static_cast<int16_t>((raw[3] << 8) | raw[2]);
+    out.z = static_cast<int16_t>((raw[5] << 8) | raw[4]);
+  }
+
   bool probeAddress(uint8_t addr) {
     i2c_addr_ = addr;
     uint8_t whoami = 0;
@@ -66,27 +306,10 @@ class Lsm6ds3 {
     return whoami == 0x69;
   }
 
-  bool writeReg(uint8_t reg, uint8_t val) {
-    Wire.beginTransmission(i2c_addr_);
-    Wire.write(reg);
-    Wire.write(val);
-    return Wire.endTransmission() == 0;
-  }
+  bool writeReg(uint8_t reg, uint8_t val) { return hal::i2c::writeReg(i2c_addr_, reg, val); }
 
   bool readRegs(uint8_t reg, uint8_t* out, size_t len) {
-    Wire.beginTransmission(i2c_addr_);
-    Wire.write(reg);
-    if (Wire.endTransmission(false) != 0) {
-      return false;
-    }
-    const size_t got = Wire.requestFrom(static_cast<int>(i2c_addr_), static_cast<int>(len));
-    if (got != len) {
-      return false;
-    }
-    for (size_t i = 0; i < len; ++i) {
-      out[i] = Wire.read();
-    }
-    return true;
+    return hal::i2c::readRegs(i2c_addr_, reg, out, len);
   }
 
   uint8_t i2c_addr_ = 0x6A;
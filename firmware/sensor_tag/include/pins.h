@@ -7,7 +7,14 @@ static constexpr int PIN_I2C_SDA = 5;
 // LSM6DS3 SCL -> ESP32-C3 GPIO6
 static constexpr int PIN_I2C_SCL = 6;
 
-// TODO: Optional battery ADC pin. Keep -1 if not used.
+// LSM6DS3 INT1 (wake-up interrupt) -> ESP32-C3 GPIO3. Only GPIO0-5 can wake
+// the C3 from deep sleep. Set -1 if not wired; the tag then wakes on its timer
+// alone.
+static constexpr int PIN_IMU_INT1 = 3;
+
+// Optional battery sense: the cell through a kBatteryDividerRatio:1 divider
+// (config.h) to an ADC1 pin (GPIO0-4). Keep -1 if not wired; the tag then
+// stays in the normal power tier.
 static constexpr int PIN_BATTERY_ADC = -1;
 
 #endif
@@ -0,0 +1,92 @@
+#ifndef SENSOR_POWER_POLICY_H
+#define SENSOR_POWER_POLICY_H
+
+#include <stdint.h>
+
+#include "config.h"
+#include "protocol/activity_batch.h"
+
+// Battery-aware duty cycle. The tier follows the smoothed battery voltage
+// with hysteresis (thresholds in config.h) and sets how long the tag sleeps,
+// how long it samples and how many windows it batches per transmission. The
+// display receives the tier with every batch.
+namespace power_policy {
+
+using Tier = protocol::PowerTier;
+
+struct Policy {
+  uint32_t sleep_s;      // deep-sleep timer after motion
+  uint32_t max_sleep_s;  // ceiling of the still back-off
+  uint32_t window_ms;    // longest IMU window
+  uint32_t batch_every_wakes;
+};
+
+static_assert(kTierCriticalMv + kTierHysteresisMv < kTierSaverMv, "tier thresholds overlap");
+static_assert(kImuMinWindowMs <= kCriticalWindowMs && kCriticalWindowMs <= kSaverWindowMs &&
+                  kSaverWindowMs <= kImuSampleWindowMs,
+              "tier IMU windows must shrink within [kImuMinWindowMs, kImuSampleWindowMs]");
+static_assert(kBatchEveryWakes * protocol::tierScale(Tier::kCritical).batch <= kBatchCapacity,
+              "the critical tier's batch must fit in kBatchCapacity");
+static_assert(kBatteryAdcSamples >= 3, "the trimmed mean drops two of the battery samples");
+
+inline uint32_t windowMsFor(Tier tier) {
+  switch (tier) {
+    case Tier::kSaver:
+      return kSaverWindowMs;
+    case Tier::kCritical:
+      return kCriticalWindowMs;
+    case Tier::kNormal:
+      break;
+  }
+  return kImuSampleWindowMs;
+}
+
+inline Policy policyFor(Tier tier) {
+  const protocol::TierScale scale = protocol::tierScale(tier);
+  return {kDeepSleepSeconds * scale.sleep, kDeepSleepMaxSeconds * scale.sleep, windowMsFor(tier),
+          kBatchEveryWakes * scale.batch};
+}
+
+inline Tier tierAt(uint32_t mv) {
+  return mv < kTierCriticalMv ? Tier::kCritical : mv < kTierSaverMv ? Tier::kSaver : Tier::kNormal;
+}
+
+// Tier for a smoothed reading of `mv` while running in `current`: down as
+// soon as a threshold is crossed, back up only kTierHysteresisMv above it.
+// 0 mV (no battery sense) keeps `current`.
+inline Tier nextTier(Tier current, uint16_t mv) {
+  if (mv == 0) {
+    return current;
+  }
+  const Tier down = tierAt(mv);
+  const Tier up = tierAt(mv > kTierHysteresisMv ? mv - kTierHysteresisMv : 0);
+  if (down > current) {
+    return down;
+  }
+  return up < current ? up : current;
+}
+
+// Folds a new reading into the value kept across wakes (0 = none yet).
+inline uint16_t smooth(uint16_t filtered, uint16_t mv) {
+  if (mv == 0 || filtered == 0) {
+    return mv == 0 ? filtered : mv;
+  }
+  const int32_t step = (static_cast<int32_t>(mv) - filtered) / (1 << kBatteryFilterShift);
+  return static_cast<uint16_t>(filtered + step);
+}
+
+inline const char* tierName(Tier tier) {
+  switch (tier) {
+    case Tier::kNormal:
+      return "normal";
+    case Tier::kSaver:
+      return "saver";
+    case Tier::kCritical:
+      return "critical";
+  }
+  return "?";
+}
+
+}  // namespace power_policy
+
+#endif
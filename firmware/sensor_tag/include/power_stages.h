@@ -1,12 +1,19 @@
 #ifndef SENSOR_POWER_STAGES_H
 #define SENSOR_POWER_STAGES_H
 
-#include <Arduino.h>
+#include "hal/console.h"
+#include "trace/trace.h"
 
+// Marks the start of a stage: timed by the tracer (see trace/trace.h) and
+// echoed to Serial. `name` must be a string literal.
 #define LOG_STAGE(name)              \
   do {                               \
+    trace::mark(name);               \
     Serial.print("[STAGE] ");       \
     Serial.println(name);            \
   } while (0)
 
+// Serial command byte that requests a trace::dump().
+static constexpr int kTraceDumpCommand = 'T';
+
 #endif
@@ -0,0 +1,53 @@
+#ifndef SENSOR_RUNNING_STATS_H
+#define SENSOR_RUNNING_STATS_H
+
+#include <stdint.h>
+
+namespace stats {
+
+// Streaming mean/variance of non-negative integer samples in fixed memory.
+// The first two moments are kept exactly in 64-bit integers, so there is no
+// floating-point cancellation for Welford's update to guard against, and no
+// FPU is needed. Exact for up to 1365 samples (the LSM6DS3 FIFO) of up to
+// 2^17, i.e. any |x| + |y| + |z| of a sample in LSB.
+class RunningStats {
+ public:
+  void reset() {
+    n_ = 0;
+    sum_ = 0;
+    sum_sq_ = 0;
+  }
+
+  void add(uint32_t x) {
+    ++n_;
+    sum_ += x;
+    sum_sq_ += static_cast<uint64_t>(x) * x;
+  }
+
+  uint32_t count() const { return n_; }
+  uint64_t sum() const { return sum_; }
+  uint32_t mean() const { return n_ == 0 ? 0 : static_cast<uint32_t>(sum_ / n_); }
+
+  // True once the z-sigma confidence interval of the mean is within
+  // +/-`halfWidth`: z * s / sqrt(n) < halfWidth, with s the sample standard
+  // deviation. Evaluated squared so neither division nor sqrt is needed.
+  bool meanWithin(uint16_t halfWidth, uint32_t z) const {
+    if (n_ < 2) {
+      return false;
+    }
+    const uint64_t n = n_;
+    // n * (n - 1) * s^2
+    const uint64_t m2 = n * sum_sq_ - sum_ * sum_;
+    const uint64_t h = halfWidth;
+    return static_cast<uint64_t>(z) * z * m2 < h * h * n * n * (n - 1);
+  }
+
+ private:
+  uint32_t n_ = 0;
+  uint64_t sum_ = 0;
+  uint64_t sum_sq_ = 0;
+};
+
+}  // namespace stats
+
+#endif
@@ -1,14 +1,14 @@
-#include <Arduino.h>
-#include <BLEDevice.h>
-#include <esp_sleep.h>
-#include <math.h>
+#include <string.h>
 
-#include "activity_algo.h"
-#include "ble_protocol.h"
+#include "activity_log.h"
+#include "activity_window.h"
 #include "config.h"
+#include "hal/hal.h"
 #include "imu_lsm6ds3.h"
 #include "pins.h"
+#include "power_policy.h"
 #include "power_stages.h"
+#include "protocol/activity_batch.h"
 
 enum class SensorState {
   BOOT,
@@ -18,34 +18,45 @@ enum class SensorState {
   BLE_TX,
   RADIO_OFF,
   DEEP_SLEEP,
+  RECORD,
 };
 
 namespace {
 
-class SensorServerCallbacks : public BLEServerCallbacks {
- public:
-  void onConnect(BLEServer* /*server*/) override { connected_ = true; }
-  void onDisconnect(BLEServer* server) override {
-    connected_ = false;
-    server->startAdvertising();
-  }
-
-  bool isConnected() const { return connected_; }
-
- private:
-  bool connected_ = false;
-};
-
 SensorState g_state = SensorState::BOOT;
 imu::Lsm6ds3 g_imu;
 bool g_has_i2c_pins = false;
 bool g_imu_ready = false;
-uint32_t g_seq = 0;
-uint16_t g_activity = 0;
+// Kept in RTC memory so it keeps counting across deep sleep; receivers use
+// it to drop the repeated adverts of a burst.
+HAL_RTC_DATA uint32_t g_seq = 0;
+// Advanced in NVS on every boot from reset, when g_seq starts over at 0, and
+// sent with every batch so the display tells a restart from replays.
+HAL_RTC_DATA uint8_t g_boot_epoch = 0;
+constexpr const char* kBootEpochKey = "boot_epoch";
+activity::WindowResult g_result = {};
 uint16_t g_battery_mv = 0;
-
-float g_sum_abs_accel = 0.0f;
-uint32_t g_sample_count = 0;
+HAL_RTC_DATA activity_log::Ring<kBatchCapacity> g_log;
+// Current deep-sleep timer; 0 until the first sleep.
+HAL_RTC_DATA uint32_t g_sleep_seconds = 0;
+// Battery voltage smoothed across wakes (0 until the first reading) and the
+// power tier it has put the tag in; g_policy is that tier's duty cycle.
+HAL_RTC_DATA uint16_t g_battery_filtered_mv = 0;
+HAL_RTC_DATA power_policy::Tier g_tier = power_policy::Tier::kNormal;
+power_policy::Policy g_policy = power_policy::policyFor(power_policy::Tier::kNormal);
+hal::sleep::WakeCause g_wake_cause = hal::sleep::WakeCause::kPowerOn;
+
+constexpr imu::Odr kImuOdr = activity::window::kOdr;
+
+// The window is drained in chunks, so the buffer only holds one burst.
+constexpr size_t kImuChunkSamples = 32;
+imu::Sample g_imu_buf[kImuChunkSamples];
+activity::WindowProcessor g_window;
+
+// Recorder mode state (kImuRecorderMode).
+bool g_recording = false;
+uint32_t g_record_index = 0;
+const char* g_record_label = "-";
 
 bool validateRequiredPins() {
   bool ok = true;
@@ -60,107 +71,355 @@ bool validateRequiredPins() {
   return ok;
 }
 
+void advanceBootEpoch() {
+  uint8_t last = 0;
+  hal::storage::load(kBootEpochKey, &last, sizeof(last));
+  g_boot_epoch = static_cast<uint8_t>(last + 1);
+  if (!hal::storage::save(kBootEpochKey, &g_boot_epoch, sizeof(g_boot_epoch))) {
+    Serial.println("WARNING: boot epoch not saved; the next boot may reuse it.");
+  }
+}
+
+// Battery voltage in mV, or 0 without a battery sense pin. Calibrated
+// samples are oversampled, with the highest and lowest dropped so one noisy
+// sample cannot shift the mean, and scaled back up through the divider.
 uint16_t readBatteryMv() {
   if (PIN_BATTERY_ADC < 0) {
     return 0;
   }
-  const int raw = analogRead(PIN_BATTERY_ADC);
-  // Minimal placeholder conversion for 12-bit ADC @ 3.3V.
-  const uint32_t mv = static_cast<uint32_t>(raw) * 3300UL / 4095UL;
-  return static_cast<uint16_t>(mv);
+  uint32_t sum = 0;
+  uint32_t lo = UINT32_MAX;
+  uint32_t hi = 0;
+  for (uint8_t i = 0; i < kBatteryAdcSamples; ++i) {
+    const int sample = hal::gpio::analogReadMv(PIN_BATTERY_ADC);
+    const uint32_t mv = sample > 0 ? static_cast<uint32_t>(sample) : 0;
+    sum += mv;
+    lo = mv < lo ? mv : lo;
+    hi = mv > hi ? mv : hi;
+  }
+  const uint32_t pin_mv = (sum - lo - hi + (kBatteryAdcSamples - 2) / 2) / (kBatteryAdcSamples - 2);
+  const uint32_t mv = pin_mv * kBatteryDividerRatio;
+  return static_cast<uint16_t>(mv > 0xFFFF ? 0xFFFF : mv);
 }
 
-void sampleImuWindow() {
+// Re-reads the battery and moves between power tiers; the new duty cycle
+// applies from this wake's batching and sleep on.
+void updatePowerTier() {
+  g_battery_filtered_mv = power_policy::smooth(g_battery_filtered_mv, readBatteryMv());
+  g_battery_mv = g_battery_filtered_mv;
+  const power_policy::Tier tier = power_policy::nextTier(g_tier, g_battery_filtered_mv);
+  if (tier != g_tier) {
+    Serial.print("Power tier: ");
+    Serial.print(power_policy::tierName(g_tier));
+    Serial.print(" -> ");
+    Serial.print(power_policy::tierName(tier));
+    Serial.print(" at ");
+    Serial.print(g_battery_filtered_mv);
+    Serial.println(" mV");
+    g_tier = tier;
+  }
+  g_policy = power_policy::policyFor(g_tier);
+}
+
+// Feeds everything the FIFO holds, up to `limit` samples, into the window
+// processor.
+void drainFifo(uint16_t limit) {
+  while (g_window.count() < limit) {
+    size_t want = limit - g_window.count();
+    if (want > kImuChunkSamples) {
+      want = kImuChunkSamples;
+    }
+    const size_t got = g_imu.readFifo(g_imu_buf, want);
+    for (size_t i = 0; i < got; ++i) {
+      g_window.add(g_imu_buf[i]);
+    }
+    if (got < want) {
+      break;
+    }
+  }
+}
+
+// Samples one window of at most `windowMs`.
+void sampleImuWindow(uint32_t windowMs) {
   LOG_STAGE("IMU_SAMPLING_START");
-  g_sum_abs_accel = 0.0f;
-  g_sample_count = 0;
+  g_window.begin();
+  const uint16_t limit = activity::window::samplesAtMs(windowMs);
 
   if (!g_imu_ready) {
     Serial.println("IMU not ready; skipping sampling.");
     return;
   }
 
-  const uint32_t start_ms = millis();
-  while (millis() - start_ms < kImuSampleWindowMs) {
-    imu::Sample s = {0.0f, 0.0f, 0.0f};
-    if (g_imu.readAccel(s)) {
-      g_sum_abs_accel += fabsf(s.ax_g) + fabsf(s.ay_g) + fabsf(s.az_g);
-      ++g_sample_count;
+  if (!g_imu.startFifo(kImuOdr, limit)) {
+    Serial.println("IMU FIFO setup failed; skipping sampling.");
+    return;
+  }
+
+  // The sensor fills its FIFO unattended; light-sleep through the minimum
+  // window, then in check intervals until the score has settled.
+  Serial.flush();
+  hal::sleep::lightUs(static_cast<uint64_t>(kImuMinWindowMs) * 1000ULL);
+  uint32_t elapsed_ms = kImuMinWindowMs;
+  drainFifo(limit);
+
+  bool settled = g_window.settled();
+  while (!settled && elapsed_ms < windowMs) {
+    uint32_t step_ms = windowMs - elapsed_ms;
+    if (step_ms > kImuCheckIntervalMs) {
+      step_ms = kImuCheckIntervalMs;
+    }
+    hal::sleep::lightUs(static_cast<uint64_t>(step_ms) * 1000ULL);
+    elapsed_ms += step_ms;
+    drainFifo(limit);
+    settled = g_window.settled();
+  }
+
+  if (!settled) {
+    // ODR tolerance can leave the last sample or two of a full window
+    // outstanding on wake.
+    const uint32_t slack_start = hal::clock::millis();
+    while (g_window.count() < limit && (hal::clock::millis() - slack_start < kImuFifoSlackMs)) {
+      hal::clock::delayMs(5);
+      drainFifo(limit);
     }
-    delay(kImuSamplePeriodMs);
   }
+  g_imu.stopFifo();
 
   Serial.print("IMU samples: ");
-  Serial.println(g_sample_count);
+  Serial.print(g_window.count());
+  Serial.println(settled ? " (settled early)" : "");
 }
 
-void sendBlePayload() {
-  LOG_STAGE("BLE_ON");
-
-  BLEDevice::init(kBleDeviceName);
-  BLEServer* server = BLEDevice::createServer();
-  auto* callbacks = new SensorServerCallbacks();
-  server->setCallbacks(callbacks);
+// ---- Recorder mode ----
+// Streams the raw FIFO as an IMU trace (see tools/replay_trace.cpp):
+//   IMU-TRACE,1,<odr_hz>,<ug_per_lsb>
+//   IMU,<t_ms>,<x>,<y>,<z>,<label>
+// Samples are timestamped from their FIFO index, so the trace keeps the
+// sensor's own timebase. The label applies until changed over Serial with
+// r (resting), w (walking), h (high) or - (unlabelled).
+
+void pollRecorderLabel() {
+  while (Serial.available() > 0) {
+    switch (Serial.read()) {
+      case 'r':
+        g_record_label = "resting";
+        break;
+      case 'w':
+        g_record_label = "walking";
+        break;
+      case 'h':
+        g_record_label = "high";
+        break;
+      case '-':
+        g_record_label = "-";
+        break;
+      default:
+        continue;
+    }
+    Serial.print("# label ");
+    Serial.println(g_record_label);
+  }
+}
 
-  BLEService* service = server->createService(BLEUUID(BLE_SERVICE_UUID));
-  BLECharacteristic* ch = service->createCharacteristic(
-      BLEUUID(BLE_CHAR_UUID),
-      BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY);
+void recordImu() {
+  if (!g_recording) {
+    if (!g_imu_ready || !g_imu.startFifo(kImuOdr, kImuChunkSamples, imu::FifoMode::kContinuous)) {
+      Serial.println("Recorder: IMU not available.");
+      hal::clock::delayMs(1000);
+      return;
+    }
+    Serial.print("IMU-TRACE,1,");
+    Serial.print(imu::odrHz(kImuOdr));
+    Serial.print(",");
+    Serial.println(imu::kMicroGPerLsb);
+    g_recording = true;
+    g_record_index = 0;
+  }
 
-  service->start();
+  pollRecorderLabel();
+  for (;;) {
+    const size_t got = g_imu.readFifo(g_imu_buf, kImuChunkSamples);
+    for (size_t i = 0; i < got; ++i) {
+      const uint64_t t_ms = static_cast<uint64_t>(g_record_index++) * 1000ULL / imu::odrHz(kImuOdr);
+      Serial.print("IMU,");
+      Serial.print(static_cast<unsigned long>(t_ms));
+      Serial.print(",");
+      Serial.print(g_imu_buf[i].x);
+      Serial.print(",");
+      Serial.print(g_imu_buf[i].y);
+      Serial.print(",");
+      Serial.print(g_imu_buf[i].z);
+      Serial.print(",");
+      Serial.println(g_record_label);
+    }
+    if (got < kImuChunkSamples) {
+      break;
+    }
+  }
+  hal::clock::delayMs(kRecorderPollMs);
+}
 
-  BLEAdvertising* adv = BLEDevice::getAdvertising();
-  adv->addServiceUUID(BLEUUID(BLE_SERVICE_UUID));
-  adv->start();
+static_assert(protocol::kMinFrameLen <= hal::ble::kMaxNotifyLen &&
+                  protocol::kMinFrameLen <= hal::ble::kMaxBroadcastLen,
+              "a BLE frame must hold at least one activity record");
+
+// Encodes pending records from `first` into one kActivityBatch frame of at
+// most `cap` bytes, packing as many as fit. Ages are taken relative to
+// `now_s`. Returns the frame length and sets `n` to the records it carries.
+size_t encodeBatch(size_t first, uint32_t now_s, uint8_t* out, size_t cap, size_t& n) {
+  const size_t last = g_log.count - 1;
+  const activity_log::Record& head = g_log.at(first);
+  protocol::ActivityBatchWriter writer(out, cap);
+  const activity_log::Record& newest = g_log.at(last);
+  const power_policy::Tier tier = static_cast<power_policy::Tier>(newest.power_tier);
+  writer.begin(head.seq, now_s - head.time_s, newest.battery_mv, tier, g_boot_epoch);
+  for (size_t i = first; i <= last; ++i) {
+    const activity_log::Record& r = g_log.at(i);
+    const uint8_t activity = static_cast<uint8_t>(r.activity > 100 ? 100 : r.activity);
+    if (!writer.add(activity, r.activity_class, now_s - r.time_s)) {
+      break;
+    }
+  }
+  n = writer.size();
+  return writer.finish();
+}
 
-  const uint32_t start_wait = millis();
-  while (!callbacks->isConnected() && (millis() - start_wait < kBleConnectTimeoutMs)) {
-    delay(20);
+void broadcastBlePayload() {
+  LOG_STAGE("BLE_ON");
+  hal::ble::init(kBleDeviceName);
+
+  LOG_STAGE("BLE_SEND");
+  // One burst per frame; the receiver de-duplicates by sequence number.
+  const uint32_t now_s = hal::clock::rtcSeconds();
+  size_t sent = 0;
+  while (sent < g_log.count) {
+    uint8_t frame[hal::ble::kMaxBroadcastLen];
+    size_t n = 0;
+    const size_t len = encodeBatch(sent, now_s, frame, sizeof(frame), n);
+    if (len == 0 || !hal::ble::startBroadcast(kBleAdvCompanyId, frame, len, kBleAdvIntervalMs)) {
+      Serial.println("BLE: broadcast start failed; keeping the rest of the batch.");
+      break;
+    }
+    hal::clock::delayMs(kBleAdvBurstMs);
+    hal::ble::stopBroadcast();
+    sent += n;
   }
+  // Adverts are unacknowledged: a burst that went out is spent, one that
+  // never started stays queued for the next transmission.
+  g_log.drop(sent);
 
-  if (callbacks->isConnected()) {
-    ActivityPayload payload{};
-    payload.seq = g_seq;
-    payload.activity = g_activity;
-    payload.battery_mv = g_battery_mv;
+  LOG_STAGE("BLE_OFF");
+  hal::ble::deinit();
+}
+
+void sendBlePayload() {
+  LOG_STAGE("BLE_ON");
+
+  hal::ble::init(kBleDeviceName);
+  hal::ble::startPeripheral(kBleServiceUuid, kBleCharUuid);
 
+  const uint32_t start_wait = hal::clock::millis();
+  while (!hal::ble::peripheralConnected() &&
+         (hal::clock::millis() - start_wait < kBleConnectTimeoutMs)) {
+    hal::clock::delayMs(20);
+  }
+
+  if (hal::ble::peripheralConnected()) {
     LOG_STAGE("BLE_SEND");
-    ch->setValue(reinterpret_cast<uint8_t*>(&payload), sizeof(payload));
-    ch->notify();
-    delay(kBlePostNotifyDelayMs);
+    const uint32_t now_s = hal::clock::rtcSeconds();
+    size_t sent = 0;
+    while (sent < g_log.count && hal::ble::peripheralConnected()) {
+      uint8_t frame[hal::ble::kMaxNotifyLen];
+      size_t n = 0;
+      const size_t len = encodeBatch(sent, now_s, frame, sizeof(frame), n);
+      if (len == 0 || !hal::ble::notify(frame, len)) {
+        break;
+      }
+      sent += n;
+    }
+    hal::clock::delayMs(kBlePostNotifyDelayMs);
+    g_log.drop(sent);
   } else {
-    Serial.println("BLE: no central connected before timeout.");
+    Serial.println("BLE: no central connected before timeout; keeping batch.");
   }
 
-  adv->stop();
+  hal::ble::stopPeripheral();
   LOG_STAGE("BLE_OFF");
-  BLEDevice::deinit(true);
+  hal::ble::deinit();
+}
+
+void maybeDumpTrace() {
+  bool requested = false;
+  while (Serial.available() > 0) {
+    requested |= (Serial.read() == kTraceDumpCommand);
+  }
+  const bool periodic = kTraceDumpEveryWakes != 0 && (trace::wakes() % kTraceDumpEveryWakes) == 0;
+  if (requested || periodic) {
+    trace::dump();
+  }
+}
+
+// Motion woke us, showed up in the window just sampled, or the window was
+// classified above rest, so the sleep timer follows the class we report.
+bool motionDetected() {
+  return g_wake_cause == hal::sleep::WakeCause::kGpio || g_window.motion() ||
+         g_result.activity_class != activity::ActivityClass::kResting;
 }
 
 void enterDeepSleep() {
   LOG_STAGE("DEEP_SLEEP");
-  esp_sleep_enable_timer_wakeup(static_cast<uint64_t>(kDeepSleepSeconds) * 1000000ULL);
+  const bool still = !motionDetected();
+  if (!still || g_sleep_seconds < g_policy.sleep_s) {
+    g_sleep_seconds = g_policy.sleep_s;
+  } else {
+    const uint32_t doubled = g_sleep_seconds * 2;
+    g_sleep_seconds = doubled > g_policy.max_sleep_s ? g_policy.max_sleep_s : doubled;
+  }
+
+  // While active the short timer already catches every window, and the
+  // interrupt would only wake us early; arm it only once backed off.
+  bool motion_wake = false;
+  if (still && g_imu_ready && PIN_IMU_INT1 >= 0) {
+    motion_wake = g_imu.enableWakeOnMotion(kImuOdr, kWakeThresholdMg, kWakeDurationSamples) &&
+                  hal::sleep::enableGpioWake(PIN_IMU_INT1, true);
+    if (!motion_wake) {
+      Serial.println("Wake-on-motion setup failed; timer wake only.");
+    }
+  }
+
+  Serial.print("Sleeping ");
+  Serial.print(g_sleep_seconds);
+  Serial.println(motion_wake ? " s or until motion." : " s.");
   Serial.flush();
-  delay(50);
-  esp_deep_sleep_start();
+  hal::clock::delayMs(50);
+  hal::sleep::deepUs(static_cast<uint64_t>(g_sleep_seconds) * 1000000ULL);
 }
 
 }  // namespace
 
 void setup() {
   Serial.begin(115200);
-  delay(300);
+  hal::clock::delayMs(300);
 }
 
 void loop() {
   switch (g_state) {
     case SensorState::BOOT:
+      trace::beginWake();
       LOG_STAGE("IDLE");
+      g_policy = power_policy::policyFor(g_tier);
+      g_wake_cause = hal::sleep::wakeCause();
+      if (g_wake_cause == hal::sleep::WakeCause::kGpio) {
+        Serial.println("Woken by motion.");
+      } else if (g_wake_cause == hal::sleep::WakeCause::kPowerOn) {
+        advanceBootEpoch();
+      }
       g_has_i2c_pins = validateRequiredPins();
       g_state = SensorState::IMU_INIT;
       break;
 
     case SensorState::IMU_INIT: {
+      LOG_STAGE("IMU_INIT");
       g_imu_ready = false;
       if (!g_has_i2c_pins) {
         Serial.println("I2C pins missing; IMU init skipped.");
@@ -175,47 +434,91 @@ void loop() {
         }
         Serial.print("IMU init failed, retry ");
         Serial.println(i + 1);
-        delay(100);
+        hal::clock::delayMs(100);
       }
 
-      if (!g_imu_ready) {
+      if (g_imu_ready) {
+        // Release INT1 and stop the wake-up logic while awake.
+        g_imu.readWakeSource();
+        g_imu.disableWakeOnMotion();
+      } else {
         Serial.println("IMU init failed after retries; using activity=0.");
       }
-      g_state = SensorState::SENSE_IMU;
+      g_state = kImuRecorderMode ? SensorState::RECORD : SensorState::SENSE_IMU;
       break;
     }
 
     case SensorState::SENSE_IMU:
-      sampleImuWindow();
+      sampleImuWindow(g_policy.window_ms);
       g_state = SensorState::PROCESS;
       break;
 
     case SensorState::PROCESS: {
-      if (g_sample_count > 0) {
-        const float avg = g_sum_abs_accel / static_cast<float>(g_sample_count);
-        g_activity = activity::computeActivityFromAverage(avg);
+      LOG_STAGE("PROCESS");
+      g_result = activity::scoreWindow(g_window);
+      updatePowerTier();
+      Serial.print("Features: sma=");
+      Serial.print(g_result.features.sma);
+      Serial.print(" vm=");
+      Serial.print(g_result.features.vm_mean);
+      Serial.print(" p2p=");
+      Serial.print(g_result.features.p2p);
+      Serial.print(" zcr_q4=");
+      Serial.print(g_result.features.zcr_hz_q4);
+      Serial.print(" energy=");
+      Serial.println(g_result.features.energy);
+      Serial.print("Activity: ");
+      Serial.print(g_result.activity);
+      Serial.print(" (");
+      Serial.print(activity::className(g_result.activity_class));
+      Serial.println(")");
+
+      activity_log::Record record;
+      record.seq = g_seq;
+      record.time_s = hal::clock::rtcSeconds();
+      record.activity = g_result.activity;
+      record.battery_mv = g_battery_mv;
+      record.activity_class = static_cast<uint8_t>(g_result.activity_class);
+      record.power_tier = static_cast<uint8_t>(g_tier);
+      g_log.push(record);
+
+      if (g_log.count >= g_policy.batch_every_wakes || g_log.full()) {
+        g_state = SensorState::BLE_TX;
       } else {
-        g_activity = 0;
+        Serial.print("Batched ");
+        Serial.print(static_cast<uint32_t>(g_log.count));
+        Serial.print("/");
+        Serial.print(g_policy.batch_every_wakes);
+        Serial.println(" records; radio stays off.");
+        g_state = SensorState::RADIO_OFF;
       }
-      g_battery_mv = readBatteryMv();
-      Serial.print("Activity: ");
-      Serial.println(g_activity);
-      g_state = SensorState::BLE_TX;
       break;
     }
 
     case SensorState::BLE_TX:
-      sendBlePayload();
+      if (kBleTransport == BleTransport::kAdvertising) {
+        broadcastBlePayload();
+      } else {
+        sendBlePayload();
+      }
       g_state = SensorState::RADIO_OFF;
       break;
 
     case SensorState::RADIO_OFF:
       ++g_seq;
+      maybeDumpTrace();
       g_state = SensorState::DEEP_SLEEP;
       break;
 
+    case SensorState::RECORD:
+      recordImu();
+      break;
+
     case SensorState::DEEP_SLEEP:
       enterDeepSleep();
+      // Only reached on native builds, where deep sleep returns instead of
+      // rebooting the chip.
+      g_state = SensorState::BOOT;
       break;
   }
 }
@@ -0,0 +1,80 @@
+// Host benchmark for the tag's activity classifier (activity_classifier.h and
+// the generated activity_model.h): inference latency and table footprint.
+//
+//   g++ -std=gnu++11 -O2 -DHAL_NATIVE -Ifirmware/sensor_tag/include
+//       -Ifirmware/lib/hal/include tools/bench_classifier.cpp -o bench_classifier
+//   ./bench_classifier [ITERATIONS]
+//
+// Host nanoseconds do not transfer directly to the ESP32-C3; the compare
+// count (at most kMaxDepth) and the table bytes do. For the code size on
+// target, build env:seeed_xiao_esp32c3 and run riscv32-esp-elf-nm
+// --size-sort -C on firmware.elf, looking for activity::classify.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+
+#include "activity_classifier.h"
+
+namespace {
+
+// xorshift32: deterministic inputs spread over the ranges the kernel emits.
+uint32_t g_rng = 2463534242u;
+uint32_t next() {
+  g_rng ^= g_rng << 13;
+  g_rng ^= g_rng >> 17;
+  g_rng ^= g_rng << 5;
+  return g_rng;
+}
+
+uint8_t pathLength(const activity::Features& f) {
+  using namespace activity;
+  uint8_t node = 0;
+  uint8_t steps = 0;
+  while (model::kFeature[node] != model::kLeaf) {
+    node = featureValue(f, model::kFeature[node]) <= model::kThreshold[node] ? model::kLeft[node]
+                                                                              : model::kRight[node];
+    ++steps;
+  }
+  return steps;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const unsigned long iterations = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000000UL;
+
+  static const size_t kInputs = 4096;
+  static activity::Features inputs[kInputs];
+  uint32_t class_hist[3] = {0, 0, 0};
+  uint32_t steps_total = 0;
+  for (size_t i = 0; i < kInputs; ++i) {
+    activity::Features& f = inputs[i];
+    f.samples = 39;
+    f.sma = static_cast<uint16_t>(next() % 40000);
+    f.vm_mean = static_cast<uint16_t>(f.sma * 7 / 10);
+    f.p2p = static_cast<uint16_t>(next() % 30000);
+    f.zcr_hz_q4 = static_cast<uint16_t>(next() % 400);
+    f.energy = static_cast<uint32_t>(f.vm_mean) * f.vm_mean;
+    ++class_hist[static_cast<uint8_t>(activity::classify(f))];
+    steps_total += pathLength(f);
+  }
+
+  volatile uint32_t sink = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned long i = 0; i < iterations; ++i) {
+    sink = sink + static_cast<uint8_t>(activity::classify(inputs[i & (kInputs - 1)]));
+  }
+  const auto stop = std::chrono::steady_clock::now();
+  const double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+
+  const size_t table_bytes = sizeof(activity::model::kFeature) + sizeof(activity::model::kThreshold) +
+                             sizeof(activity::model::kLeft) + sizeof(activity::model::kRight);
+  printf("nodes              %u (max depth %u)\n", activity::model::kNodeCount, activity::model::kMaxDepth);
+  printf("table flash        %zu bytes\n", table_bytes);
+  printf("mean compares      %.2f per inference\n", static_cast<double>(steps_total) / kInputs);
+  printf("host latency       %.2f ns per inference (%lu runs)\n", ns / iterations, iterations);
+  printf("classes (random)   resting %u, walking %u, high %u\n", class_hist[0], class_hist[1], class_hist[2]);
+  return 0;
+}
@@ -0,0 +1,33 @@
+#!/bin/sh
+# Builds tools/sim_e2e.cpp: the sensor-tag and display-meter firmwares and the
+# native HAL in one host program. Each firmware is linked into a relocatable
+# object whose symbols are all made local except setup()/loop(), which are
+# renamed <project>_setup/<project>_loop, so the two never clash.
+#
+#   tools/build_sim_e2e.sh [OUTPUT]   (from the repository root; default ./sim_e2e)
+set -e
+
+out=${1:-sim_e2e}
+cxx=${CXX:-g++}
+fw=firmware
+flags="-std=gnu++11 -O2 -DHAL_NATIVE -DHAL_NATIVE_NO_MAIN -I$fw/lib/hal/include -I$fw/lib/protocol/include
+       -I$fw/lib/trace/include"
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+for app in sensor_tag display_meter; do
+  for src in $fw/$app/src/*.cpp $fw/lib/trace/src/*.cpp $fw/lib/protocol/src/*.cpp; do
+    $cxx $flags -I$fw/$app/include -c "$src" -o "$work/$app-$(basename "$src" .cpp).o"
+  done
+  ld -r "$work/$app"-*.o -o "$work/$app-all.o"
+  # COMDAT groups must go, or the localised inline functions keep their
+  # group signatures and the final link discards one firmware's copies.
+  objcopy -R .group \
+      --redefine-sym _Z5setupv=${app}_setup --redefine-sym _Z4loopv=${app}_loop \
+      --keep-global-symbol=${app}_setup --keep-global-symbol=${app}_loop \
+      "$work/$app-all.o" "$work/$app.o"
+done
+
+hal=$(ls $fw/lib/hal/src/native/*.cpp | grep -v main_native)
+$cxx $flags tools/sim_e2e.cpp $fw/lib/protocol/src/*.cpp $hal \
+    "$work/sensor_tag.o" "$work/display_meter.o" -o "$out"
@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+"""Project the sensor tag's battery drain and life from a serial log.
+
+Usage:
+    energy_budget.py [LOG]                       # reads stdin when LOG is omitted
+    energy_budget.py --current radio=60 LOG      # override a state's current
+    energy_budget.py --sleep-s 120 LOG           # what-if: mean deep sleep per wake
+
+The log is a tag capture: from hardware, or from the native build, e.g.
+    .pio/build/native/program --seconds 86400 --ble-peer | energy_budget.py
+
+Awake time per wake comes from the last stage-trace dump (TRACE1, see
+trace_decode.py): each stage's total duration divided by the traced wakes,
+so stages that only run on some wakes (BLE_*) are weighted by how often they
+run. Every stage maps to a power state with a current below. Boot (ROM and
+setup()) and the flush before deep sleep are not traced; they are added
+per wake from their fixed durations in main.cpp.
+
+Sleep time per wake comes from the "Sleeping N s" lines. When the lines are
+timestamped (native runs) the actual time to the next wake is used, so
+motion wakes are accounted for; otherwise the requested N. A line ending
+"or until motion" means the LSM6DS3 stayed on in low power to catch it.
+
+The currents are planning figures from the ESP32-C3, LSM6DS3 and MCP1700
+datasheets (docs/datasheets) and typical ESP32-C3 BLE draw; replace them
+with power-profiler measurements of your board via --current.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from trace_decode import decode  # noqa: E402
+
+# Power states, in mA.
+CURRENT_MA = {
+    "cpu": 22.0,        # ESP32-C3 at 160 MHz, radio off (modem-sleep)
+    "imu_window": 0.35,  # light sleep 0.13 mA + LSM6DS3 at 26 Hz, high-performance + FIFO drains
+    "radio": 35.0,      # BLE controller on: advertising, waiting for or linked to a central
+    "sleep": 0.010,     # deep sleep 5 uA + MCP1700 quiescent 1.6 uA + LSM6DS3 powered down 3 uA
+    "wake_on_motion": 0.025,  # LSM6DS3 low-power at 26 Hz on top of "sleep" while armed
+}
+
+STAGE_STATE = {
+    "IDLE": "cpu",
+    "IMU_INIT": "cpu",
+    "IMU_SAMPLING_START": "imu_window",
+    "PROCESS": "cpu",
+    "BLE_ON": "radio",
+    "BLE_SEND": "radio",
+    "BLE_OFF": "cpu",
+    "DEEP_SLEEP": "cpu",
+}
+
+# Untraced per-wake time, ms: ROM boot plus setup()'s 300 ms delay, and
+# enterDeepSleep()'s 50 ms flush before sleeping.
+BOOT_MS = 330.0
+PRE_SLEEP_MS = 50.0
+
+BATTERIES = [("CR2032", 225), ("LiPo 150 mAh", 150), ("LiPo 200 mAh", 200), ("LiPo 300 mAh", 300)]
+# A coin cell cannot source the radio's current; flag it above this.
+COIN_CELL_MAX_MA = 10.0
+
+CONFIG_KEYS = ["kBleTransport", "kImuSampleWindowMs", "kImuMinWindowMs", "kBleConnectTimeoutMs",
+               "kBleAdvBurstMs", "kDeepSleepSeconds", "kDeepSleepMaxSeconds", "kBatchEveryWakes"]
+
+TIMESTAMP = re.compile(r"^\[\s*(\d+)\.(\d+)\]")
+SLEEPING = re.compile(r"Sleeping (\d+) s( or until motion)?\.")
+
+
+def read_config(path):
+    values = {}
+    with open(path, encoding="utf-8") as f:
+        for m in re.finditer(r"static constexpr [\w:]+ (k\w+) = ([^;]+);", f.read()):
+            values[m.group(1)] = m.group(2).strip()
+    return values
+
+
+def timestamp(line):
+    m = TIMESTAMP.match(line)
+    return int(m.group(1)) + int(m.group(2)) / 1000.0 if m else None
+
+
+def parse_log(stream):
+    """Returns (last TRACE1 dump, [(sleep_s, wake_on_motion)])."""
+    dump = None
+    sleeps = []
+    pending = None  # (requested_s, wake_on_motion, t_s) awaiting the next wake
+    for line in stream:
+        idx = line.find("TRACE1 ")
+        if idx >= 0:
+            dump = line[idx + len("TRACE1 "):].strip()
+            continue
+        t = timestamp(line)
+        m = SLEEPING.search(line)
+        if m:
+            pending = (int(m.group(1)), m.group(2) is not None, t)
+            continue
+        if pending is not None and "[STAGE] IDLE" in line:
+            requested, wom, t_sleep = pending
+            slept = requested
+            if t is not None and t_sleep is not None:
+                slept = max(0.0, t - t_sleep - PRE_SLEEP_MS / 1e3)
+            sleeps.append((slept, wom))
+            pending = None
+    if pending is not None:
+        sleeps.append((pending[0], pending[1]))
+    return dump, sleeps
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", help="serial log (default: stdin)")
+    parser.add_argument("--config", default=os.path.join(os.path.dirname(os.path.abspath(__file__)), "..",
+                                                         "firmware", "sensor_tag", "include", "config.h"),
+                        help="tag config.h, echoed for reference")
+    parser.add_argument("--current", action="append", default=[], metavar="STATE=MA",
+                        help="override a state's current (%s)" % ", ".join(CURRENT_MA))
+    parser.add_argument("--sleep-s", type=float, help="mean deep sleep per wake instead of the log's")
+    parser.add_argument("--usable", type=float, default=0.8,
+                        help="fraction of rated capacity delivered before brown-out (default 0.8)")
+    args = parser.parse_args()
+
+    current = dict(CURRENT_MA)
+    for item in args.current:
+        state, _, ma = item.partition("=")
+        if state not in current:
+            sys.exit("unknown state %r" % state)
+        current[state] = float(ma)
+
+    stream = open(args.log, encoding="utf-8", errors="replace") if args.log else sys.stdin
+    dump, sleeps = parse_log(stream)
+    if dump is None:
+        sys.exit("no TRACE1 dump found")
+    trace = decode(bytes.fromhex(dump))
+    wakes = trace["wakes"]
+    if wakes == 0:
+        sys.exit("trace has no wakes")
+
+    if os.path.exists(args.config):
+        config = read_config(args.config)
+        print("config: " + "  ".join("%s=%s" % (k, config[k].split("::")[-1])
+                                      for k in CONFIG_KEYS if k in config))
+
+    if args.sleep_s is not None:
+        sleep_s, wom_share = args.sleep_s, 0.0
+        sleep_note = "--sleep-s"
+    elif sleeps:
+        sleep_s = sum(s for s, _ in sleeps) / len(sleeps)
+        wom_share = sum(s for s, wom in sleeps if wom) / max(sum(s for s, _ in sleeps), 1e-9)
+        sleep_note = "%d sleeps in log, %.0f%% of it with wake-on-motion" % (len(sleeps), 100 * wom_share)
+    else:
+        sys.exit("no \"Sleeping\" lines in the log; pass --sleep-s")
+
+    # (row, state, ms per wake, mA)
+    rows = [("boot", "cpu", BOOT_MS, current["cpu"])]
+    for s in trace["stages"]:
+        if s["count"] == 0:
+            continue
+        state = STAGE_STATE.get(s["name"], "cpu")
+        rows.append((s["name"], state, s["sum_us"] / 1e3 / wakes, current[state]))
+    rows.append(("pre-sleep", "cpu", PRE_SLEEP_MS, current["cpu"]))
+    sleep_ma = current["sleep"] + wom_share * current["wake_on_motion"]
+    rows.append(("deep sleep", "sleep", sleep_s * 1e3, sleep_ma))
+
+    charge_mas = sum(ms * ma for _, _, ms, ma in rows) / 1e3
+    period_s = sum(ms for _, _, ms, _ in rows) / 1e3
+    awake_s = period_s - sleep_s
+
+    print("wakes traced: %d; mean sleep %.1f s (%s)" % (wakes, sleep_s, sleep_note))
+    print()
+    print("%-20s %-10s %8s %12s %12s %7s" % ("stage", "state", "mA", "ms/wake", "uAh/wake", "share"))
+    for name, state, ms, ma in rows:
+        mas = ms * ma / 1e3
+        print("%-20s %-10s %8.3f %12.1f %12.3f %6.1f%%" % (
+            name, state, ma, ms, mas / 3.6, 100 * mas / charge_mas if charge_mas else 0.0))
+    print()
+
+    avg_ma = charge_mas / period_s
+    mah_day = avg_ma * 24
+    print("per wake: %.2f s awake, %.1f s asleep, %.2f uAh" % (awake_s, sleep_s, charge_mas / 3.6))
+    print("average current %.3f mA -> %.2f mAh/day" % (avg_ma, mah_day))
+    print()
+    peak_ma = max(ma for _, _, _, ma in rows)
+    print("%-16s %12s   (%.0f%% of rated capacity usable)" % ("battery", "life", 100 * args.usable))
+    for name, mah in BATTERIES:
+        days = mah * args.usable / mah_day if mah_day else float("inf")
+        note = ""
+        if name == "CR2032" and peak_ma > COIN_CELL_MAX_MA:
+            note = "  * peaks of %.0f mA exceed a coin cell; expect far less" % peak_ma
+        print("%-16s %9.1f d%s" % (name, days, note))
+
+
+if __name__ == "__main__":
+    main()
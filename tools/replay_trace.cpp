@@ -0,0 +1,297 @@
+// Replays recorded IMU traces through the tag's own window code
+// (activity_window.h: feature kernel, early termination, SMA score and the
+// generated classifier) and reports accuracy and throughput.
+//
+//   g++ -std=gnu++11 -O2 -DHAL_NATIVE -Ifirmware/sensor_tag/include
+//       -Ifirmware/lib/hal/include tools/replay_trace.cpp -o replay_trace
+//   ./replay_trace [--features-csv OUT] [--repeat N] TRACE...
+//
+// A trace is any text file, typically a serial capture of the tag in recorder
+// mode (kImuRecorderMode), containing:
+//   IMU-TRACE,1,<odr_hz>,<ug_per_lsb>        header, starts a segment
+//   IMU,<t_ms>,<x>,<y>,<z>,<label>           one raw sample in LSB
+// Text before the marker on a line (log timestamps) is ignored. <label> is
+// resting, walking, high or - for unlabelled. A gap of more than 1.5 sample
+// periods starts a new segment; windows never span segments.
+//
+// Windows are cut back to back exactly as sampleImuWindow() would see them.
+// A window is scored against its label only if every sample carries the
+// same label. --features-csv writes one row per labelled window in the
+// format tools/train_classifier.py --csv reads.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "activity_window.h"
+
+namespace {
+
+constexpr int kClasses = 3;
+const char* const kClassNames[kClasses] = {"resting", "walking", "high"};
+
+struct TraceSample {
+  imu::Sample s;
+  int8_t label;  // class index, or -1 when unlabelled
+};
+
+using Segment = std::vector<TraceSample>;
+
+int8_t parseLabel(const char* text) {
+  for (int i = 0; i < kClasses; ++i) {
+    if (strncmp(text, kClassNames[i], strlen(kClassNames[i])) == 0) {
+      return static_cast<int8_t>(i);
+    }
+  }
+  return -1;
+}
+
+bool loadTrace(const char* path, std::vector<Segment>& segments) {
+  FILE* f = fopen(path, "r");
+  if (f == nullptr) {
+    fprintf(stderr, "%s: cannot open\n", path);
+    return false;
+  }
+
+  const uint32_t odr_hz = imu::odrHz(activity::window::kOdr);
+  const long max_gap_ms = static_cast<long>(1500 / odr_hz) + 1;
+  bool have_header = false;
+  long last_t_ms = -1;
+  char line[256];
+  unsigned line_no = 0;
+  while (fgets(line, sizeof(line), f) != nullptr) {
+    ++line_no;
+    const char* header = strstr(line, "IMU-TRACE,");
+    if (header != nullptr) {
+      unsigned version = 0;
+      unsigned odr = 0;
+      unsigned ug = 0;
+      if (sscanf(header, "IMU-TRACE,%u,%u,%u", &version, &odr, &ug) != 3 || version != 1) {
+        fprintf(stderr, "%s:%u: unsupported trace header\n", path, line_no);
+        fclose(f);
+        return false;
+      }
+      if (odr != odr_hz || ug != imu::kMicroGPerLsb) {
+        fprintf(stderr, "%s:%u: trace is %u Hz / %u ug/LSB, firmware expects %u Hz / %u ug/LSB\n", path,
+                line_no, odr, ug, odr_hz, imu::kMicroGPerLsb);
+        fclose(f);
+        return false;
+      }
+      have_header = true;
+      segments.push_back(Segment());
+      last_t_ms = -1;
+      continue;
+    }
+
+    const char* rec = strstr(line, "IMU,");
+    if (rec == nullptr) {
+      continue;
+    }
+    if (!have_header) {
+      fprintf(stderr, "%s:%u: sample before IMU-TRACE header\n", path, line_no);
+      fclose(f);
+      return false;
+    }
+    long t_ms = 0;
+    int x = 0;
+    int y = 0;
+    int z = 0;
+    int label_at = 0;
+    if (sscanf(rec, "IMU,%ld,%d,%d,%d,%n", &t_ms, &x, &y, &z, &label_at) < 4 || label_at == 0) {
+      fprintf(stderr, "%s:%u: malformed sample\n", path, line_no);
+      continue;
+    }
+    if (last_t_ms >= 0 && (t_ms <= last_t_ms || t_ms - last_t_ms > max_gap_ms)) {
+      segments.push_back(Segment());
+    }
+    last_t_ms = t_ms;
+
+    TraceSample ts;
+    ts.s.x = static_cast<int16_t>(x);
+    ts.s.y = static_cast<int16_t>(y);
+    ts.s.z = static_cast<int16_t>(z);
+    ts.label = parseLabel(rec + label_at);
+    segments.back().push_back(ts);
+  }
+  fclose(f);
+  return true;
+}
+
+// Feeds one window from `s` the way sampleImuWindow() drains the FIFO: after
+// kImuMinWindowMs, then every kImuCheckIntervalMs until settled or the full
+// window. Returns the samples consumed, or 0 if the segment ran out first.
+size_t runWindow(const TraceSample* s, size_t available, activity::WindowProcessor& w) {
+  using activity::window::samplesAtMs;
+  w.begin();
+  size_t fed = 0;
+  auto feedTo = [&](size_t n) {
+    while (fed < n && fed < available) {
+      w.add(s[fed++].s);
+    }
+    return fed == n;
+  };
+
+  uint32_t elapsed_ms = kImuMinWindowMs;
+  if (!feedTo(samplesAtMs(elapsed_ms))) {
+    return 0;
+  }
+  bool settled = w.settled();
+  while (!settled && elapsed_ms < kImuSampleWindowMs) {
+    uint32_t step_ms = kImuSampleWindowMs - elapsed_ms;
+    step_ms = step_ms > kImuCheckIntervalMs ? kImuCheckIntervalMs : step_ms;
+    elapsed_ms += step_ms;
+    if (!feedTo(samplesAtMs(elapsed_ms))) {
+      return 0;
+    }
+    settled = w.settled();
+  }
+  return fed;
+}
+
+int8_t windowLabel(const TraceSample* s, size_t n) {
+  const int8_t label = s[0].label;
+  for (size_t i = 1; i < n; ++i) {
+    if (s[i].label != label) {
+      return -1;
+    }
+  }
+  return label;
+}
+
+double ratio(double num, double den) { return den > 0 ? num / den : 0.0; }
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const char* features_csv = nullptr;
+  unsigned repeat = 20;
+  std::vector<Segment> segments;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--features-csv") == 0 && i + 1 < argc) {
+      features_csv = argv[++i];
+    } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+      repeat = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+    } else if (!loadTrace(argv[i], segments)) {
+      return 1;
+    }
+  }
+  if (segments.empty()) {
+    fprintf(stderr, "usage: %s [--features-csv OUT] [--repeat N] TRACE...\n", argv[0]);
+    return 2;
+  }
+
+  FILE* csv = nullptr;
+  if (features_csv != nullptr) {
+    csv = fopen(features_csv, "w");
+    if (csv == nullptr) {
+      fprintf(stderr, "%s: cannot create\n", features_csv);
+      return 1;
+    }
+    fprintf(csv, "label,sma,vm_mean,p2p,zcr_hz_q4,energy\n");
+  }
+
+  uint32_t confusion[kClasses][kClasses] = {};
+  uint64_t activity_sum[kClasses] = {};
+  uint32_t windows = 0;
+  uint32_t unlabelled = 0;
+  uint32_t early = 0;
+  uint64_t samples_total = 0;
+  uint64_t window_samples = 0;
+
+  activity::WindowProcessor w;
+  for (const Segment& seg : segments) {
+    samples_total += seg.size();
+    size_t pos = 0;
+    while (pos < seg.size()) {
+      const size_t used = runWindow(&seg[pos], seg.size() - pos, w);
+      if (used == 0) {
+        break;
+      }
+      const activity::WindowResult r = activity::scoreWindow(w);
+      const int8_t label = windowLabel(&seg[pos], used);
+      ++windows;
+      window_samples += used;
+      early += used < activity::window::kMaxSamples ? 1 : 0;
+      if (label < 0) {
+        ++unlabelled;
+      } else {
+        ++confusion[label][static_cast<uint8_t>(r.activity_class)];
+        activity_sum[label] += r.activity;
+        if (csv != nullptr) {
+          fprintf(csv, "%s,%u,%u,%u,%u,%u\n", kClassNames[label], r.features.sma, r.features.vm_mean,
+                  r.features.p2p, r.features.zcr_hz_q4, r.features.energy);
+        }
+      }
+      pos += used;
+    }
+  }
+  if (csv != nullptr) {
+    fclose(csv);
+  }
+
+  // Throughput: the same windows again, timed, without parsing or output.
+  volatile uint32_t sink = 0;
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned rep = 0; rep < repeat; ++rep) {
+    for (const Segment& seg : segments) {
+      size_t pos = 0;
+      while (pos < seg.size()) {
+        const size_t used = runWindow(&seg[pos], seg.size() - pos, w);
+        if (used == 0) {
+          break;
+        }
+        sink = sink + activity::scoreWindow(w).activity;
+        pos += used;
+      }
+    }
+  }
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  printf("segments           %zu\n", segments.size());
+  printf("samples            %llu\n", static_cast<unsigned long long>(samples_total));
+  printf("windows            %u (%u unlabelled or mixed, %u ended early, %.1f samples mean)\n", windows,
+         unlabelled, early, ratio(static_cast<double>(window_samples), windows));
+
+  uint32_t scored = 0;
+  uint32_t correct = 0;
+  double f1_sum = 0.0;
+  printf("\nconfusion (rows: label, columns: predicted)\n%-10s", "");
+  for (int p = 0; p < kClasses; ++p) {
+    printf("%9s", kClassNames[p]);
+  }
+  printf("\n");
+  for (int t = 0; t < kClasses; ++t) {
+    printf("%-10s", kClassNames[t]);
+    for (int p = 0; p < kClasses; ++p) {
+      printf("%9u", confusion[t][p]);
+      scored += confusion[t][p];
+      correct += t == p ? confusion[t][p] : 0;
+    }
+    printf("\n");
+  }
+
+  printf("\n%-10s %9s %9s %9s %9s %9s\n", "class", "windows", "precision", "recall", "f1", "activity");
+  for (int c = 0; c < kClasses; ++c) {
+    uint32_t label_total = 0;
+    uint32_t predicted_total = 0;
+    for (int k = 0; k < kClasses; ++k) {
+      label_total += confusion[c][k];
+      predicted_total += confusion[k][c];
+    }
+    const double precision = ratio(confusion[c][c], predicted_total);
+    const double recall = ratio(confusion[c][c], label_total);
+    const double f1 = ratio(2.0 * precision * recall, precision + recall);
+    f1_sum += f1;
+    printf("%-10s %9u %9.3f %9.3f %9.3f %9.1f\n", kClassNames[c], label_total, precision, recall, f1,
+           ratio(static_cast<double>(activity_sum[c]), label_total));
+  }
+  printf("\naccuracy           %.3f (%u windows)\n", ratio(correct, scored), scored);
+  printf("macro f1           %.3f\n", f1_sum / kClasses);
+  printf("throughput         %.2f Msamples/s on this host (%u passes)\n",
+         ratio(static_cast<double>(samples_total) * repeat, seconds) / 1e6, repeat);
+  return 0;
+}
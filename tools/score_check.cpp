@@ -0,0 +1,91 @@
+// Host check that the tag's integer activity score (activity_algo.h) agrees
+// with the float rule it implements, 0 g -> 0 and kSmaFullScaleMicroG -> 100
+// clamped, to within 1 point.
+//
+//   g++ -std=gnu++11 -O2 -DHAL_NATIVE -Ifirmware/sensor_tag/include
+//       -Ifirmware/lib/hal/include tools/score_check.cpp -o score_check
+//   ./score_check [WINDOWS]
+//
+// Every SMA a window can produce (Features::sma is 16 bits) is scored at
+// each LSM6DS3 full scale. Then WINDOWS random windows (default 200000) of
+// per-sample |dx|+|dy|+|dz| values are scored both ways: the firmware takes
+// the truncated integer mean the feature kernel keeps, the reference the
+// exact float mean. Exits non-zero if any score is off by more than 1.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <random>
+
+#include "activity_algo.h"
+#include "activity_window.h"
+#include "imu_lsm6ds3.h"
+
+namespace {
+
+constexpr imu::FullScale kScales[] = {imu::FullScale::k2g, imu::FullScale::k4g, imu::FullScale::k8g,
+                                      imu::FullScale::k16g};
+
+double referenceScore(double smaLsb, uint32_t microGPerLsb) {
+  const double score = smaLsb * microGPerLsb / (activity::kSmaFullScaleMicroG / 100.0);
+  return score > 100.0 ? 100.0 : floor(score + 0.5);
+}
+
+struct Tally {
+  uint64_t checked = 0;
+  uint64_t off_by_one = 0;
+  uint64_t worse = 0;
+
+  void add(int got, double want) {
+    const double diff = fabs(got - want);
+    ++checked;
+    off_by_one += diff >= 0.5 && diff <= 1.0 ? 1 : 0;
+    worse += diff > 1.0 ? 1 : 0;
+  }
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const uint32_t windows = argc > 1 ? static_cast<uint32_t>(strtoul(argv[1], nullptr, 10)) : 200000;
+  bool ok = true;
+
+  for (imu::FullScale fs : kScales) {
+    const uint32_t ug = imu::microGPerLsb(fs);
+    Tally t;
+    for (uint32_t sma = 0; sma <= 0xFFFF; ++sma) {
+      t.add(activity::computeActivityFromSma(sma, ug), referenceScore(sma, ug));
+    }
+    printf("sma sweep  %5u ug/LSB: %llu scores, %llu off by 1, %llu worse\n", static_cast<unsigned int>(ug),
+           static_cast<unsigned long long>(t.checked), static_cast<unsigned long long>(t.off_by_one),
+           static_cast<unsigned long long>(t.worse));
+    ok = ok && t.worse == 0;
+  }
+
+  std::mt19937 rng(514);
+  for (imu::FullScale fs : kScales) {
+    const uint32_t ug = imu::microGPerLsb(fs);
+    // Up to 2 g of dynamic acceleration summed over three axes.
+    std::uniform_int_distribution<uint32_t> l1(0, 3 * 2000000 / ug);
+    std::uniform_int_distribution<uint32_t> len(activity::window::kMinSamples, activity::window::kMaxSamples);
+    Tally t;
+    for (uint32_t w = 0; w < windows / 4; ++w) {
+      const uint32_t n = len(rng);
+      uint64_t sum = 0;
+      for (uint32_t i = 0; i < n; ++i) {
+        sum += l1(rng);
+      }
+      const uint32_t sma = static_cast<uint32_t>(sum / n);
+      t.add(activity::computeActivityFromSma(sma > 0xFFFF ? 0xFFFF : sma, ug),
+            referenceScore(static_cast<double>(sum) / n, ug));
+    }
+    printf("windows    %5u ug/LSB: %llu scores, %llu off by 1, %llu worse\n", static_cast<unsigned int>(ug),
+           static_cast<unsigned long long>(t.checked), static_cast<unsigned long long>(t.off_by_one),
+           static_cast<unsigned long long>(t.worse));
+    ok = ok && t.worse == 0;
+  }
+
+  printf("%s\n", ok ? "all within 1 point" : "FAILED");
+  return ok ? 0 : 1;
+}
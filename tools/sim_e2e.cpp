@@ -0,0 +1,206 @@
+// End-to-end simulation: the real sensor-tag and display-meter firmwares run
+// side by side on the native HAL, talking through its simulated air
+// (hal::sim::setAir), for days of virtual time in seconds of host time.
+// Reports how long activity records take from the tag's window to the
+// display, reconnects, link drops and records that never arrived.
+//
+//   tools/build_sim_e2e.sh            (run from the repository root)
+//   ./sim_e2e [--days N | --seconds N] [--latency-ms N] [--loss-permille N]
+//             [--drop-mean-ms N] [--rssi DBM] [--away-rssi DBM] [--away-ms N]
+//             [--log]
+//
+// Both firmwares define setup(), loop() and same-named globals, so the build
+// script links each into one relocatable object with every symbol but
+// setup()/loop() made local, and renames those to <project>_setup/_loop.
+// The transport is whatever kBleTransport the two config.h files select;
+// they must agree. --log prints both consoles, each line tagged with its
+// node.
+//
+// A record's creation time is taken as the frame's send time minus the
+// record's age, so latencies have the protocol's one-second resolution.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "hal/console.h"
+#include "hal/sim.h"
+#include "protocol/activity_batch.h"
+
+extern "C" void sensor_tag_setup();
+extern "C" void sensor_tag_loop();
+extern "C" void display_meter_setup();
+extern "C" void display_meter_loop();
+
+namespace {
+
+// The sensor tag wires LSM6DS3 INT1 to GPIO3.
+constexpr int kImuInt1Pin = 3;
+
+size_t g_tag = 0;
+size_t g_display = 0;
+
+uint32_t g_frames = 0;
+uint32_t g_duplicates = 0;
+std::vector<bool> g_delivered;  // by seq
+std::vector<uint64_t> g_latency_ms;
+
+// Runs as the display for every frame it is handed.
+void onAirFrame(const hal::sim::AirFrame& frame) {
+  if (frame.from != g_tag || frame.to != g_display) {
+    return;
+  }
+  const protocol::ActivityBatchView batch(frame.data, frame.len);
+  if (!batch.valid()) {
+    return;
+  }
+  ++g_frames;
+  const uint64_t now_us = hal::sim::nowUs();
+  protocol::ActivityBatchView::Iterator it = batch.records();
+  protocol::ActivityRecord rec;
+  while (it.next(rec)) {
+    if (rec.seq >= g_delivered.size()) {
+      g_delivered.resize(rec.seq + 1, false);
+    }
+    if (g_delivered[rec.seq]) {
+      ++g_duplicates;
+      continue;
+    }
+    g_delivered[rec.seq] = true;
+    const uint64_t age_us = rec.age_s * 1000000ULL;
+    const uint64_t created_us = frame.sentUs > age_us ? frame.sentUs - age_us : 0;
+    g_latency_ms.push_back((now_us - created_us) / 1000ULL);
+  }
+}
+
+uint64_t percentile(const std::vector<uint64_t>& sorted, unsigned p) {
+  return sorted.empty() ? 0 : sorted[(sorted.size() - 1) * p / 100];
+}
+
+void printLatency() {
+  std::vector<uint64_t> sorted = g_latency_ms;
+  std::sort(sorted.begin(), sorted.end());
+  printf("record latency    p50 %.1f s  p90 %.1f s  p99 %.1f s  max %.1f s\n", percentile(sorted, 50) / 1e3,
+         percentile(sorted, 90) / 1e3, percentile(sorted, 99) / 1e3,
+         sorted.empty() ? 0.0 : sorted.back() / 1e3);
+
+  static const uint64_t kEdgesMs[] = {1000, 5000, 30000, 60000, 300000, 1800000};
+  constexpr size_t kBuckets = sizeof(kEdgesMs) / sizeof(kEdgesMs[0]) + 1;
+  size_t counts[kBuckets] = {};
+  for (uint64_t ms : sorted) {
+    size_t b = 0;
+    while (b < kBuckets - 1 && ms >= kEdgesMs[b]) {
+      ++b;
+    }
+    ++counts[b];
+  }
+  for (size_t b = 0; b < kBuckets; ++b) {
+    char label[24];
+    if (b < kBuckets - 1) {
+      snprintf(label, sizeof(label), "< %llu s", static_cast<unsigned long long>(kEdgesMs[b] / 1000));
+    } else {
+      snprintf(label, sizeof(label), ">= %llu s", static_cast<unsigned long long>(kEdgesMs[b - 1] / 1000));
+    }
+    const double share = sorted.empty() ? 0.0 : 100.0 * counts[b] / sorted.size();
+    printf("  %-10s %8zu  %5.1f%%  ", label, counts[b], share);
+    for (int bar = 0; bar < static_cast<int>(share / 2); ++bar) {
+      putchar('#');
+    }
+    putchar('\n');
+  }
+}
+
+void printNode(size_t node) {
+  hal::sim::selectNode(node);
+  const hal::sim::Stats& s = hal::sim::stats();
+  printf("%s:\n", hal::sim::nodeName(node));
+  printf("  loop iterations %u, deep sleeps %u (%.0f s), light sleeps %u (%.0f s)\n", s.loopIterations,
+         s.deepSleeps, s.deepSleepUs / 1e6, s.lightSleeps, s.lightSleepUs / 1e6);
+  printf("  radio on %.0f s, ble inits %u, storage writes %u\n", s.radioOnUs / 1e6, s.bleInits,
+         s.storageWrites);
+  printf("  notifies tx/rx %u/%u, broadcasts %u, adverts rx %u\n", s.notifiesSent, s.notifiesReceived,
+         s.broadcasts, s.advertsReceived);
+  printf("  active scans %u (%.0f s), connects %u (%.1f ms mean), link drops %u\n", s.scans, s.scanUs / 1e6,
+         s.connects, s.connects != 0 ? s.connectUs / 1e3 / s.connects : 0.0, s.linkDrops);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  uint64_t run_seconds = 7 * 86400ULL;
+  bool log = false;
+  hal::sim::AirOptions air = {};
+  air.latencyMs = 10;
+  air.rssiDbm = -60;
+  air.awayRssiDbm = -90;
+
+  for (int i = 1; i < argc; ++i) {
+    const bool has_value = i + 1 < argc;
+    if (strcmp(argv[i], "--days") == 0 && has_value) {
+      run_seconds = strtoull(argv[++i], nullptr, 10) * 86400ULL;
+    } else if (strcmp(argv[i], "--seconds") == 0 && has_value) {
+      run_seconds = strtoull(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--latency-ms") == 0 && has_value) {
+      air.latencyMs = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--loss-permille") == 0 && has_value) {
+      air.lossPermille = static_cast<uint16_t>(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--drop-mean-ms") == 0 && has_value) {
+      air.dropMeanMs = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--rssi") == 0 && has_value) {
+      air.rssiDbm = static_cast<int8_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--away-rssi") == 0 && has_value) {
+      air.awayRssiDbm = static_cast<int8_t>(atoi(argv[++i]));
+    } else if (strcmp(argv[i], "--away-ms") == 0 && has_value) {
+      air.awayPeriodMs = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+    } else if (strcmp(argv[i], "--log") == 0) {
+      log = true;
+    } else {
+      fprintf(stderr, "unknown option: %s\n", argv[i]);
+      return 2;
+    }
+  }
+
+  g_tag = hal::sim::addNode("tag", sensor_tag_setup, sensor_tag_loop);
+  g_display = hal::sim::addNode("display", display_meter_setup, display_meter_loop);
+  hal::sim::selectNode(g_tag);
+  hal::sim::attachI2c(0x6A, &hal::sim::lsm6ds3());
+  hal::sim::setLsm6ds3Int1Pin(kImuInt1Pin);
+  hal::sim::setAir(air);
+  hal::sim::setAirTap(onAirFrame);
+  hal::sim::setConsoleEnabled(log);
+
+  const auto host_start = std::chrono::steady_clock::now();
+  hal::sim::runNodes(run_seconds * 1000000ULL);
+  const double host_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - host_start).count();
+  Serial.flush();
+
+  size_t delivered = 0;
+  size_t first = g_delivered.size();
+  for (size_t seq = 0; seq < g_delivered.size(); ++seq) {
+    if (g_delivered[seq]) {
+      first = std::min(first, seq);
+      ++delivered;
+    }
+  }
+  const size_t span = first < g_delivered.size() ? g_delivered.size() - first : 0;
+
+  hal::sim::selectNode(g_display);
+  const hal::sim::Stats& display = hal::sim::stats();
+  printf("\n--- end-to-end run summary ---\n");
+  printf("virtual time      %.1f h in %.2f s host (%.0fx)\n", run_seconds / 3600.0, host_s,
+         host_s > 0 ? run_seconds / host_s : 0.0);
+  printf("air               latency %u ms, loss %u permille, drop mean %u ms\n", air.latencyMs,
+         air.lossPermille, air.dropMeanMs);
+  printf("frames delivered  %u\n", g_frames);
+  printf("records           %zu delivered, %zu missed, %u duplicate\n", delivered, span - delivered,
+         g_duplicates);
+  printf("reconnects        %u (display connects), %u link drops\n", display.connects, display.linkDrops);
+  printLatency();
+  printNode(g_tag);
+  printNode(g_display);
+  return 0;
+}
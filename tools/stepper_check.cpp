@@ -0,0 +1,102 @@
+// Host check of the display's gauge stepper engine (motor_gauge.h): runs the
+// step timer ISR on the native HAL's virtual clock and checks that every move
+// heads for its target and ends there.
+//
+//   g++ -std=gnu++11 -O2 -DHAL_NATIVE -DHAL_NATIVE_NO_MAIN -Ifirmware/display_meter/include
+//       -Ifirmware/lib/hal/include tools/stepper_check.cpp
+//       $(ls firmware/lib/hal/src/native/*.cpp | grep -v main_native) -o stepper_check
+//   ./stepper_check
+//
+// A move started from rest must never take a step away from its target
+// (the needle would twitch the wrong way first); homing must only ever step
+// towards the stop. Exits non-zero on the first failure.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hal/sim.h"
+#include "motor_gauge.h"
+
+namespace {
+
+int g_failures = 0;
+
+void check(bool ok, const char* what) {
+  printf("%-56s %s\n", what, ok ? "ok" : "FAIL");
+  g_failures += ok ? 0 : 1;
+}
+
+// Runs the engine until it settles; returns the step furthest away from
+// `target` on the wrong side of `from` (0 if none), in engine positions.
+int32_t runMove(int32_t from, int32_t target) {
+  const motor_gauge::Engine& e = motor_gauge::engine();
+  const int32_t dir = target >= from ? 1 : -1;
+  int32_t overshoot = 0;
+  for (int i = 0; i < 1000000 && motor_gauge::isMoving(); ++i) {
+    hal::sim::advanceUs(50);
+    const int32_t wrong = (from - e.pos) * dir;
+    overshoot = wrong > overshoot ? wrong : overshoot;
+  }
+  return overshoot;
+}
+
+bool moveFromRest(int32_t from, int32_t to) {
+  motor_gauge::restore(from);
+  motor_gauge::setTarget(to);
+  const int32_t overshoot = runMove(from * motor_gauge::kMicrosteps, to * motor_gauge::kMicrosteps);
+  return overshoot == 0 && !motor_gauge::isMoving() && motor_gauge::currentPos() == to;
+}
+
+}  // namespace
+
+int main() {
+  hal::sim::setConsoleEnabled(false);
+  if (!motor_gauge::init()) {
+    fprintf(stderr, "motor_gauge::init failed\n");
+    return 1;
+  }
+
+  check(moveFromRest(300, 290), "rest at 300 -> 290: no step up first");
+  check(moveFromRest(100, 120), "rest at 100 -> 120: no step down first");
+  check(moveFromRest(kGaugeMaxSteps, 0), "rest at max -> 0: full sweep down");
+  check(moveFromRest(5, 4), "rest at 5 -> 4: single step down");
+
+  // The needle animator retargets every kNeedleTickMs on the way down; each
+  // retarget may find the engine at rest.
+  motor_gauge::restore(400);
+  bool down_only = true;
+  int32_t last = motor_gauge::engine().pos;
+  for (int32_t goal = 390; goal >= 200; goal -= 10) {
+    motor_gauge::setTarget(goal);
+    for (uint32_t t = 0; t < kNeedleTickMs * 1000; t += 50) {
+      hal::sim::advanceUs(50);
+      down_only = down_only && motor_gauge::engine().pos <= last;
+      last = motor_gauge::engine().pos;
+    }
+  }
+  runMove(motor_gauge::engine().pos, 200 * motor_gauge::kMicrosteps);
+  check(down_only && motor_gauge::currentPos() == 200, "downward retargets every tick: never steps up");
+
+  // Reversal mid-move must brake, then come back and settle on the target.
+  motor_gauge::restore(100);
+  motor_gauge::setTarget(300);
+  hal::sim::advanceUs(200000);
+  motor_gauge::setTarget(50);
+  runMove(motor_gauge::engine().pos, 50 * motor_gauge::kMicrosteps);
+  check(!motor_gauge::isMoving() && motor_gauge::currentPos() == 50, "reversal mid-move settles on target");
+
+  const bool homing = motor_gauge::home();
+  motor_gauge::setTarget(150);
+  const int32_t home_pos = motor_gauge::engine().pos;
+  int32_t highest = home_pos;
+  while (motor_gauge::isHoming()) {
+    hal::sim::advanceUs(50);
+    highest = motor_gauge::engine().pos > highest ? motor_gauge::engine().pos : highest;
+  }
+  check(homing && highest == home_pos, "homing: never steps away from the stop");
+  runMove(motor_gauge::engine().pos, 150 * motor_gauge::kMicrosteps);
+  check(!motor_gauge::isMoving() && motor_gauge::currentPos() == 150, "homing then takes the pending target");
+
+  printf("%s\n", g_failures == 0 ? "all passed" : "FAILED");
+  return g_failures == 0 ? 0 : 1;
+}
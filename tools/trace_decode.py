@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Decode stage-trace dumps ("TRACE1 <hex>" lines) from a firmware serial log.
+
+Usage:
+    trace_decode.py [LOG]          # reads stdin when LOG is omitted
+    trace_decode.py --events LOG   # also print the event timeline
+
+Only the last dump in the log is decoded unless --all is given. See
+firmware/lib/trace/src/trace.cpp for the layout.
+"""
+
+import argparse
+import struct
+import sys
+
+
+class Reader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def take(self, fmt):
+        size = struct.calcsize(fmt)
+        if self.pos + size > len(self.data):
+            raise ValueError("truncated trace dump")
+        values = struct.unpack_from(fmt, self.data, self.pos)
+        self.pos += size
+        return values if len(values) > 1 else values[0]
+
+    def bytes(self, n):
+        if self.pos + n > len(self.data):
+            raise ValueError("truncated trace dump")
+        out = self.data[self.pos:self.pos + n]
+        self.pos += n
+        return out
+
+
+def decode(blob):
+    r = Reader(blob)
+    version = r.take("<B")
+    if version != 1:
+        raise ValueError("unsupported trace version %d" % version)
+    wakes = r.take("<I")
+    stage_count = r.take("<B")
+    event_count = r.take("<H")
+
+    stages = []
+    for _ in range(stage_count):
+        name = r.bytes(r.take("<B")).decode("ascii", "replace")
+        count, min_us, max_us, sum_us = r.take("<IIIQ")
+        stages.append({"name": name, "count": count, "min_us": min_us,
+                       "max_us": max_us, "sum_us": sum_us})
+
+    events = []
+    for _ in range(event_count):
+        t_us, stage, wake = r.take("<IBB")
+        events.append((wake, t_us, stage))
+    return {"wakes": wakes, "stages": stages, "events": events}
+
+
+def print_stages(trace):
+    print("wakes: %d" % trace["wakes"])
+    print("%-20s %8s %12s %12s %12s %14s" % ("stage", "count", "min_us", "avg_us", "max_us", "total_ms"))
+    for s in trace["stages"]:
+        if s["count"] == 0:
+            print("%-20s %8d %12s %12s %12s %14s" % (s["name"], 0, "-", "-", "-", "-"))
+            continue
+        print("%-20s %8d %12d %12d %12d %14.1f" % (
+            s["name"], s["count"], s["min_us"], s["sum_us"] // s["count"],
+            s["max_us"], s["sum_us"] / 1000.0))
+
+
+def print_events(trace):
+    names = [s["name"] for s in trace["stages"]]
+    prev = None
+    for wake, t_us, stage in trace["events"]:
+        delta = "" if prev is None or prev[0] != wake else "+%d" % (t_us - prev[1])
+        name = names[stage] if stage < len(names) else "#%d" % stage
+        print("wake %3d %12d us %-20s %s" % (wake, t_us, name, delta))
+        prev = (wake, t_us)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", nargs="?", help="serial log (default: stdin)")
+    parser.add_argument("--events", action="store_true", help="print the event timeline")
+    parser.add_argument("--all", action="store_true", help="decode every dump, not just the last")
+    args = parser.parse_args()
+
+    stream = open(args.log, encoding="utf-8", errors="replace") if args.log else sys.stdin
+    dumps = []
+    for line in stream:
+        idx = line.find("TRACE1 ")
+        if idx >= 0:
+            dumps.append(line[idx + len("TRACE1 "):].strip())
+    if not dumps:
+        sys.exit("no TRACE1 dump found")
+
+    for hexdump in (dumps if args.all else dumps[-1:]):
+        trace = decode(bytes.fromhex(hexdump))
+        print_stages(trace)
+        if args.events:
+            print()
+            print_events(trace)
+        print()
+
+
+if __name__ == "__main__":
+    main()
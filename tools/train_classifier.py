@@ -0,0 +1,332 @@
+#!/usr/bin/env python3
+"""Train the tag's resting / walking / high-activity decision tree and emit it
+as a header of constexpr integer tables.
+
+Usage:
+    train_classifier.py [--csv FEATURES.csv] [--out HEADER] [--depth N]
+                        [--per-class N] [--seed N] [--write-trace TRACE]
+
+With --csv the tree is fit to recorded windows; the CSV needs a header row
+with the columns label,sma,vm_mean,p2p,zcr_hz_q4,energy where label is one of
+resting, walking, high. Without it the tree is fit to synthetic windows whose
+features come from a bit-exact port of activity::FeatureKernel
+(firmware/sensor_tag/include/activity_features.h), so thresholds land on the
+same integer scale the tag computes at runtime.
+
+The output (by default firmware/sensor_tag/include/activity_model.h) is
+consumed by activity_classifier.h. tools/replay_trace.cpp --features-csv
+produces a suitable CSV from recorded IMU traces.
+
+--write-trace also writes fresh synthetic windows (not used for training) as
+an IMU trace, to exercise tools/replay_trace.cpp end to end.
+"""
+
+import argparse
+import csv
+import math
+import os
+import random
+import sys
+
+CLASSES = ["resting", "walking", "high"]
+FEATURES = ["sma", "vm_mean", "p2p", "zcr_hz_q4", "energy"]
+
+# Must match the tag: imu::kFullScale (2 g), kImuOdrHz and kZcrDeadbandMg.
+MICRO_G_PER_LSB = 61
+ODR_HZ = 26
+ZCR_DEADBAND_LSB = 50 * 1000 // MICRO_G_PER_LSB
+MAX_WINDOW_SAMPLES = 39
+MIN_WINDOW_SAMPLES = 10
+
+DEFAULT_OUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..",
+                           "firmware", "sensor_tag", "include", "activity_model.h")
+
+
+def gravity_shift(odr_hz):
+    for limit, shift in ((26, 4), (52, 5), (104, 6), (208, 7)):
+        if odr_hz <= limit:
+            return shift
+    return 8
+
+
+def isqrt(v):
+    return math.isqrt(v)
+
+
+def kernel_features(samples, odr_hz=ODR_HZ, deadband=ZCR_DEADBAND_LSB):
+    """Port of activity::FeatureKernel::add()/finish() (integer-exact)."""
+    shift = gravity_shift(odr_hz)
+    gravity = [a * 256 for a in samples[0]]
+    sign = [0, 0, 0]
+    sum_l1 = sum_vm = sum_energy = crossings = 0
+    mag2_min, mag2_max = 2 ** 32 - 1, 0
+    for s in samples:
+        l1 = vm2 = mag2 = 0
+        for i in range(3):
+            gravity[i] += (s[i] * 256 - gravity[i]) >> shift
+            d = s[i] - ((gravity[i] + 128) >> 8)
+            d = max(-32767, min(32767, d))
+            ad = abs(d)
+            l1 += ad
+            vm2 += ad * ad
+            mag2 += s[i] * s[i]
+            if (d > deadband and sign[i] < 0) or (d < -deadband and sign[i] > 0):
+                crossings += 1
+            if d > deadband:
+                sign[i] = 1
+            elif d < -deadband:
+                sign[i] = -1
+        sum_l1 += l1
+        sum_vm += isqrt(vm2)
+        sum_energy += vm2
+        mag2_min = min(mag2_min, mag2)
+        mag2_max = max(mag2_max, mag2)
+    n = len(samples)
+    clamp16 = lambda v: min(v, 0xFFFF)
+    return [clamp16(sum_l1 // n),
+            clamp16(sum_vm // n),
+            clamp16(isqrt(mag2_max) - isqrt(mag2_min)),
+            clamp16(crossings * odr_hz * 16 // n),
+            min(sum_energy // n, 2 ** 32 - 1)]
+
+
+def to_lsb(g):
+    return max(-32768, min(32767, int(round(g * 1e6 / MICRO_G_PER_LSB))))
+
+
+def random_orientation(rng, max_tilt):
+    tilt = rng.uniform(0.0, max_tilt)
+    yaw = rng.uniform(0.0, 2.0 * math.pi)
+    return (math.sin(tilt) * math.cos(yaw), math.sin(tilt) * math.sin(yaw), math.cos(tilt))
+
+
+def synth_window(rng, label, n=None):
+    """One window of raw LSB samples for `label`, loosely modelled on a
+    collar-mounted tag: gravity in a random posture plus label-dependent
+    motion and sensor noise."""
+    full = n
+    if label == "resting":
+        n = rng.randint(MIN_WINDOW_SAMPLES, MAX_WINDOW_SAMPLES)
+        g = random_orientation(rng, math.pi)
+        f, amp, jerk = rng.uniform(0.2, 0.5), rng.uniform(0.0, 0.03), 0.02
+    elif label == "walking":
+        n = MAX_WINDOW_SAMPLES
+        g = random_orientation(rng, 0.6)
+        f, amp, jerk = rng.uniform(1.4, 2.6), rng.uniform(0.1, 0.45), 0.05
+    else:
+        n = MAX_WINDOW_SAMPLES
+        g = random_orientation(rng, 1.2)
+        f, amp, jerk = rng.uniform(2.4, 4.2), rng.uniform(0.5, 1.5), 0.3
+    if full is not None:
+        n = full
+    phase = rng.uniform(0.0, 2.0 * math.pi)
+    axis_gain = [rng.uniform(0.3, 1.0) for _ in range(3)]
+    noise = 0.01
+    samples = []
+    for k in range(n):
+        t = k / ODR_HZ
+        gait = math.sin(2.0 * math.pi * f * t + phase)
+        harmonic = 0.3 * math.sin(4.0 * math.pi * f * t + 2.0 * phase)
+        out = []
+        for i in range(3):
+            a = g[i] + amp * axis_gain[i] * (gait + harmonic)
+            a += rng.uniform(-noise, noise) + rng.gauss(0.0, jerk / 3.0)
+            out.append(to_lsb(a))
+        samples.append(tuple(out))
+    return samples
+
+
+def synth_dataset(rng, per_class):
+    rows = []
+    for label_index, label in enumerate(CLASSES):
+        for _ in range(per_class):
+            rows.append((kernel_features(synth_window(rng, label)), label_index))
+    return rows
+
+
+def write_trace(path, rng, per_class):
+    """Synthetic windows as an IMU trace (the recorder-mode format). Each
+    window is its own segment, separated by a time gap, and long enough for
+    the tag's full window."""
+    lines = ["IMU-TRACE,1,%d,%d" % (ODR_HZ, MICRO_G_PER_LSB)]
+    t_ms = 0
+    for _ in range(per_class):
+        for label in CLASSES:
+            for s in synth_window(rng, label, MAX_WINDOW_SAMPLES):
+                lines.append("IMU,%d,%d,%d,%d,%s" % (t_ms, s[0], s[1], s[2], label))
+                t_ms += 1000 // ODR_HZ
+            t_ms += 1000
+    with open(path, "w") as f:
+        f.write("\n".join(lines) + "\n")
+
+
+def load_csv(path):
+    rows = []
+    with open(path, newline="") as f:
+        for rec in csv.DictReader(f):
+            rows.append(([int(rec[name]) for name in FEATURES], CLASSES.index(rec["label"])))
+    return rows
+
+
+def gini(counts):
+    total = sum(counts)
+    if total == 0:
+        return 0.0
+    return 1.0 - sum((c / total) ** 2 for c in counts)
+
+
+def class_counts(rows):
+    counts = [0] * len(CLASSES)
+    for _, label in rows:
+        counts[label] += 1
+    return counts
+
+
+def best_split(rows, min_leaf):
+    best = None
+    parent = gini(class_counts(rows)) * len(rows)
+    for feature in range(len(FEATURES)):
+        values = sorted(set(r[0][feature] for r in rows))
+        if len(values) < 2:
+            continue
+        step = max(1, len(values) // 64)
+        for j in range(0, len(values) - 1, step):
+            # Integer threshold: x <= t goes left.
+            t = (values[j] + values[j + 1]) // 2
+            left = [r for r in rows if r[0][feature] <= t]
+            right = [r for r in rows if r[0][feature] > t]
+            if len(left) < min_leaf or len(right) < min_leaf:
+                continue
+            cost = gini(class_counts(left)) * len(left) + gini(class_counts(right)) * len(right)
+            if cost < parent - 1e-9 and (best is None or cost < best[0]):
+                best = (cost, feature, t, left, right)
+    return best
+
+
+def grow(rows, depth, max_depth, min_leaf, nodes):
+    """Appends the subtree for `rows` to `nodes` (pre-order) and returns its
+    index. Nodes are [feature, threshold, left, right]; leaves use feature
+    None and keep the class in `left`."""
+    index = len(nodes)
+    counts = class_counts(rows)
+    majority = counts.index(max(counts))
+    nodes.append([None, 0, majority, 0])
+    if depth >= max_depth or max(counts) == len(rows):
+        return index
+    split = best_split(rows, min_leaf)
+    if split is None:
+        return index
+    _, feature, threshold, left, right = split
+    nodes[index][0] = feature
+    nodes[index][1] = threshold
+    nodes[index][2] = grow(left, depth + 1, max_depth, min_leaf, nodes)
+    nodes[index][3] = grow(right, depth + 1, max_depth, min_leaf, nodes)
+    left_node, right_node = nodes[nodes[index][2]], nodes[nodes[index][3]]
+    if left_node[0] is None and right_node[0] is None and left_node[2] == right_node[2]:
+        # Both sides predict the same class; the split buys nothing.
+        del nodes[index + 1:]
+        nodes[index] = [None, 0, left_node[2], 0]
+    return index
+
+
+def predict(nodes, x):
+    i = 0
+    while nodes[i][0] is not None:
+        i = nodes[i][2] if x[nodes[i][0]] <= nodes[i][1] else nodes[i][3]
+    return nodes[i][2]
+
+
+def tree_depth(nodes, i=0):
+    if nodes[i][0] is None:
+        return 0
+    return 1 + max(tree_depth(nodes, nodes[i][2]), tree_depth(nodes, nodes[i][3]))
+
+
+def accuracy(nodes, rows):
+    return sum(predict(nodes, x) == y for x, y in rows) / len(rows)
+
+
+def emit_header(nodes, source, train_acc, test_acc):
+    leaf = 0xFF
+    feat = ", ".join(str(leaf if n[0] is None else n[0]) for n in nodes)
+    thr = ", ".join(str(n[1]) for n in nodes)
+    left = ", ".join(str(n[2]) for n in nodes)
+    right = ", ".join(str(n[3]) for n in nodes)
+    return """// Generated by tools/train_classifier.py; do not edit by hand.
+// Source: {source}.
+// Accuracy: {train:.1%} train, {test:.1%} held out. Depth {depth}, {count} nodes.
+#ifndef SENSOR_ACTIVITY_MODEL_H
+#define SENSOR_ACTIVITY_MODEL_H
+
+#include <stdint.h>
+
+namespace activity {{
+namespace model {{
+
+// Feature scale the thresholds were fit at.
+static constexpr uint32_t kMicroGPerLsb = {ugpl};
+static constexpr uint32_t kOdrHz = {odr};
+
+static constexpr uint8_t kLeaf = 0xFF;
+static constexpr uint8_t kMaxDepth = {depth};
+static constexpr uint8_t kNodeCount = {count};
+
+// Node i tests Features field kFeature[i] (in activity_classifier.h order:
+// {names})
+// and goes to kLeft[i] when the value is <= kThreshold[i], else kRight[i].
+// Leaves have kFeature == kLeaf and the ActivityClass in kLeft.
+static constexpr uint8_t kFeature[kNodeCount] = {{{feat}}};
+static constexpr uint32_t kThreshold[kNodeCount] = {{{thr}}};
+static constexpr uint8_t kLeft[kNodeCount] = {{{left}}};
+static constexpr uint8_t kRight[kNodeCount] = {{{right}}};
+
+}}  // namespace model
+}}  // namespace activity
+
+#endif
+""".format(source=source, train=train_acc, test=test_acc, depth=tree_depth(nodes),
+           count=len(nodes), ugpl=MICRO_G_PER_LSB, odr=ODR_HZ, names=", ".join(FEATURES),
+           feat=feat, thr=thr, left=left, right=right)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--csv", help="recorded feature windows with labels")
+    parser.add_argument("--out", default=DEFAULT_OUT, help="header to write")
+    parser.add_argument("--depth", type=int, default=4, help="maximum tree depth")
+    parser.add_argument("--per-class", type=int, default=1500,
+                        help="synthetic windows per class (without --csv)")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--write-trace", metavar="TRACE",
+                        help="also write held-out synthetic windows as an IMU trace")
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    if args.csv:
+        rows = load_csv(args.csv)
+        source = "recorded windows from %s" % os.path.basename(args.csv)
+    else:
+        rows = synth_dataset(rng, args.per_class)
+        source = "synthetic windows, %d per class, seed %d" % (args.per_class, args.seed)
+    rng.shuffle(rows)
+    split = len(rows) * 4 // 5
+    train, test = rows[:split], rows[split:]
+
+    nodes = []
+    grow(train, 0, args.depth, max(2, len(train) // 200), nodes)
+    if len(nodes) > 254:
+        sys.exit("tree too large for 8-bit node indices")
+
+    train_acc = accuracy(nodes, train)
+    test_acc = accuracy(nodes, test) if test else train_acc
+    with open(args.out, "w") as f:
+        f.write(emit_header(nodes, source, train_acc, test_acc))
+    if args.write_trace:
+        write_trace(args.write_trace, random.Random(args.seed + 1), max(1, args.per_class // 5))
+        print("wrote %s" % args.write_trace)
+    print("wrote %s: %d nodes, depth %d, train %.1f%%, held out %.1f%%"
+          % (args.out, len(nodes), tree_depth(nodes), 100 * train_acc, 100 * test_acc))
+
+
+if __name__ == "__main__":
+    main()